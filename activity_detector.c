@@ -0,0 +1,103 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (C) 2025 The Whaley Group
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+/*
+Block energy activity detector.
+
+Each block's energy is the mean square of the loudest channel, taken on the top
+16 bits of each sample so the sum fits comfortably in 64 bits.  A noise floor
+follows the energy down quickly and up slowly (very slowly while active, so a
+long sound is not absorbed into the floor).  Activity starts when a block is
+ACTIVITY_ON_RATIO above the floor and ends after ACTIVITY_HANGOVER_BLOCKS blocks
+in a row below ACTIVITY_OFF_RATIO, which gives the on/off hysteresis.
+
+The gate works on block numbers of the capture ring.  An onset at block b opens
+the gate from b - ACTIVITY_PRETRIGGER_BLOCKS so the start of the sound is not
+clipped; this works because the sender runs ACTIVITY_PRETRIGGER_BLOCKS behind the
+detector and the ring still holds those blocks.
+*/
+
+#include "activity_detector.h"
+
+volatile bool activity_detected;
+volatile bool activity_gate_enabled;
+
+static uint64_t noise_floor;                // mean square, 16 bit sample units
+static uint32_t quiet_blocks;
+static uint32_t gate_open_from;             // first block of the current or last active span
+static uint32_t gate_open_until;            // last active block of that span
+static bool gate_seen_activity;
+
+void activity_detector_init(void) {
+    activity_detected = false;
+    activity_gate_enabled = ACTIVITY_GATE_DEFAULT;
+    noise_floor = ACTIVITY_MIN_ENERGY;
+    quiet_blocks = 0;
+    gate_seen_activity = false;
+}
+
+bool activity_detector_update(uint32_t block_num, const int (*block)[MIC_CHANNELS], int frames) {
+    uint64_t sum[MIC_CHANNELS] = {0};
+    for (int i = 0; i < frames; i++) {
+        for (int c = 0; c < MIC_CHANNELS; c++) {
+            int32_t s = block[i][c] >> 16;
+            sum[c] += (uint64_t)(s * s);
+        }
+    }
+    uint64_t loudest = 0;
+    for (int c = 0; c < MIC_CHANNELS; c++) {
+        if (sum[c] > loudest) loudest = sum[c];
+    }
+    uint64_t energy = loudest / frames;
+
+    if (energy < noise_floor) {
+        noise_floor -= (noise_floor - energy) >> 2;                 // fall fast
+    } else {
+        noise_floor += (energy - noise_floor) >> (activity_detected ? 12 : 6);   // rise slowly
+    }
+    if (noise_floor < ACTIVITY_MIN_ENERGY) noise_floor = ACTIVITY_MIN_ENERGY;
+
+    if (!activity_detected) {
+        if (energy > noise_floor * ACTIVITY_ON_RATIO) {
+            activity_detected = true;
+            quiet_blocks = 0;
+            gate_open_from = block_num - ACTIVITY_PRETRIGGER_BLOCKS;
+            gate_seen_activity = true;
+        }
+    } else if (energy < noise_floor * ACTIVITY_OFF_RATIO) {
+        if (++quiet_blocks >= ACTIVITY_HANGOVER_BLOCKS) activity_detected = false;
+    } else {
+        quiet_blocks = 0;
+    }
+    if (activity_detected) gate_open_until = block_num;
+
+    return activity_detected;
+}
+
+bool activity_gate_pass(uint32_t block_num) {
+    if (!activity_gate_enabled) return true;
+    if (!gate_seen_activity) return false;
+    return (int32_t)(block_num - gate_open_from) >= 0 && (int32_t)(gate_open_until - block_num) >= 0;
+}
@@ -0,0 +1,72 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (C) 2025 The Whaley Group
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#ifndef _ACTIVITY_DETECTOR_H_
+#define _ACTIVITY_DETECTOR_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "mic_config.h"
+
+#ifndef ACTIVITY_ON_RATIO
+#define ACTIVITY_ON_RATIO 8                 // block energy over noise floor to declare activity (~9 dB)
+#endif
+
+#ifndef ACTIVITY_OFF_RATIO
+#define ACTIVITY_OFF_RATIO 2                // energy over floor below which activity may end (~3 dB)
+#endif
+
+#ifndef ACTIVITY_HANGOVER_BLOCKS
+#define ACTIVITY_HANGOVER_BLOCKS 200        // quiet blocks before activity ends, bridges gaps between words
+#endif
+
+#ifndef ACTIVITY_MIN_ENERGY
+#define ACTIVITY_MIN_ENERGY 64              // per sample mean square (16 bit units) that is never activity, ~ -87 dBFS
+#endif
+
+#ifndef ACTIVITY_PRETRIGGER_BLOCKS
+#define ACTIVITY_PRETRIGGER_BLOCKS 8        // blocks before an onset that the gate lets through
+#endif
+
+#ifndef ACTIVITY_GATE_DEFAULT
+#define ACTIVITY_GATE_DEFAULT false         // silence the stream between activity, settable by HID feature report 3
+#endif
+
+extern volatile bool activity_detected;     // detector state after the last analysed block
+extern volatile bool activity_gate_enabled;
+
+void activity_detector_init(void);
+
+// Analyse one captured block of interleaved frames.  block_num is the running block
+// count of the capture ring so gate decisions line up with ring blocks.
+bool activity_detector_update(uint32_t block_num, const int (*block)[MIC_CHANNELS], int frames);
+
+// True if block block_num should be sent as audio: always when the gate is off,
+// otherwise when it lies inside an active span or its pre-trigger history.  The
+// caller must only ask about blocks at least ACTIVITY_PRETRIGGER_BLOCKS older than
+// the newest analysed block.
+bool activity_gate_pass(uint32_t block_num);
+
+#endif
@@ -1,12 +1,25 @@
 #!/usr/bin/env python3
 # Install python3 HID package https://pypi.org/project/hid/
 import hid
-import time
+import sys
 
 
 # default is TinyUSB (0xcafe), Adafruit (0x239a), RaspberryPi (0x2e8a), Espressif (0x303a) VID
 USB_VID = (0xcafe, 0x239a, 0x2e8a, 0x303a)
-report_ID = 1
+report_ID = 1           # sensor report: temperature, distance, status
+interval_ID = 2         # feature report: interrupt report interval in ms
+gate_ID = 3             # feature report: 1 = silence the stream between activity
+spectrum_ID = 4         # input report: sequence byte, then band levels left then right
+spectrum_cfg_ID = 5     # feature report: spectrum interval in ms, cpu cycles per block
+test_signal_ID = 6      # feature report: audio source, 0 = mics, 1 = counter, 2 = sweep
+trigger_ID = 7          # input report: trigger input, flags, capture frame, stream frame
+
+# optional argument sets the interrupt report interval in ms (0 = on change only)
+interval_ms = int(sys.argv[1]) if len(sys.argv) > 1 else None
+# optional second argument sets the band level report interval in ms (0 = off)
+spectrum_ms = int(sys.argv[2]) if len(sys.argv) > 2 else None
+# optional third argument selects the audio source, see host/stream_verify
+test_signal = int(sys.argv[3]) if len(sys.argv) > 3 else None
 
 print("VID list: " + ", ".join('%02x' % v for v in USB_VID))
 
@@ -15,7 +28,33 @@ for vid in  USB_VID:
         print(dict)
         dev = hid.Device(dict['vendor_id'], dict['product_id'])
         if dev:
+            report = dev.get_feature_report(report_ID,5)   # first byte is reportID, then data bytes LSB first
+            print("Feature bytes: ",report[0],report[1],report[2],report[3],report[4],"  Temp:",report[2]*256+report[1],"  Dist:",report[4]*256+report[3])
+            if interval_ms is not None:
+                dev.send_feature_report(bytes([interval_ID, interval_ms & 0xFF, interval_ms >> 8]))
+            if spectrum_ms is not None:
+                dev.send_feature_report(bytes([spectrum_cfg_ID, spectrum_ms & 0xFF, spectrum_ms >> 8]))
+            if test_signal is not None:
+                dev.send_feature_report(bytes([test_signal_ID, test_signal]))
             while True:
-                report = dev.get_feature_report(report_ID,5)   # first byte is reportID, then data bytes LSB first
-                print("Bytes: ",report[0],report[1],report[2],report[3],report[4],"  Temp:",report[2]*256+report[1],"  Dist:",report[4]*256+report[3])      
-                time.sleep(1)
+                report = dev.read(64)                    # blocks until the device pushes a report on the interrupt endpoint
+                if len(report) > 1 and report[0] == spectrum_ID:
+                    bands = (len(report) - 2) // 2
+                    levels = [-b / 2 for b in report[2:]]       # dB relative to a full scale sine
+                    print("Bands", report[1], " L:", levels[:bands], " R:", levels[bands:])
+                    cfg = dev.get_feature_report(spectrum_cfg_ID, 7)
+                    print("  core1 cycles per block:", int.from_bytes(cfg[3:7], 'little'))
+                    continue
+                if len(report) > 10 and report[0] == trigger_ID:
+                    flags = report[2]
+                    stream = int.from_bytes(report[7:11], 'little') if flags & 4 else None
+                    print("Trigger", report[1], "rising" if flags & 1 else "falling",
+                          "  frame:", int.from_bytes(report[3:7], 'little'), "  stream frame:", stream,
+                          "  (mics stopped)" if not flags & 2 else "", "  (edges lost before)" if flags & 8 else "")
+                    continue
+                if len(report) < 6 or report[0] != report_ID:
+                    continue
+                temp = int.from_bytes(report[1:3], 'little', signed=True)
+                dist = report[4]*256+report[3]
+                status = report[5]
+                print("Temp:",temp,"  Dist:",dist,"  Streaming:",status & 1,"  Muted:",(status >> 1) & 1,"  Activity:",(status >> 2) & 1)
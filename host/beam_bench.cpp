@@ -0,0 +1,159 @@
+/*
+Throughput benchmark for the host beamforming library.
+G. Whaley
+
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (C) 2025 The Whaley Group
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ *
+ */
+
+/*
+Usage:  beam_bench [options]
+    --beams N         number of simultaneous steered beams (default 64)
+    --channels M      microphones in the array (default 2)
+    --block F         frames per process() call (default 480 = 10 ms)
+    --seconds S       seconds of audio to process (default 60)
+    --type das|fas    delay-and-sum or filter-and-sum (default das)
+    --taps T          filter-and-sum FIR length (default 32)
+    --threads N       worker threads, 0 = all cores (default 0)
+    --temp C          air temperature in degrees C (default 20)
+    --spacing MM      microphone spacing in mm (default 390)
+    --scalar          disable the AVX2 kernels
+    --input FILE      raw interleaved SE_32 recording, e.g. from
+                      arecord -D hw:MicArray -f S32_LE -c 2 -r 48000 -t raw
+
+Without --input a synthetic plane wave arriving from 30 degrees is generated.
+The recording or synthetic buffer is looped until --seconds of audio is processed.
+*/
+
+#include "beamformer.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+using namespace micarray;
+
+static std::vector<int32_t> synthetic_input(const ArrayGeometry& g, size_t frames) {
+    // 1 kHz tone from 30 degrees plus a little noise, quantised like the microphone
+    std::vector<int32_t> buf(frames * g.channels);
+    const double angle = 30.0 * 3.14159265358979 / 180.0;
+    uint32_t lfsr = 0x12345678;
+    for (int ch = 0; ch < g.channels; ch++) {
+        double lead = g.steering_delay(ch, angle) - g.max_steering_delay() / 2.0;      // samples this element hears early
+        for (size_t n = 0; n < frames; n++) {
+            lfsr ^= lfsr << 13; lfsr ^= lfsr >> 17; lfsr ^= lfsr << 5;
+            double v = 0.5 * std::sin(2.0 * 3.14159265358979 * 1000.0 * (n + lead) / g.sample_rate)
+                     + 0.01 * ((int32_t)lfsr / 2147483648.0);
+            buf[n * g.channels + ch] = (int32_t)(v * 2147483647.0) & (int32_t)0xFFFFFF00;
+        }
+    }
+    return buf;
+}
+
+static std::vector<int32_t> load_input(const char* path, int channels) {
+    std::ifstream f(path, std::ios::binary | std::ios::ate);
+    if (!f) return {};
+    size_t bytes = (size_t)f.tellg();
+    size_t frames = bytes / (sizeof(int32_t) * channels);
+    std::vector<int32_t> buf(frames * channels);
+    f.seekg(0);
+    f.read((char*)buf.data(), buf.size() * sizeof(int32_t));
+    return buf;
+}
+
+int main(int argc, char** argv) {
+    BeamformerConfig cfg;
+    size_t beams = 64;
+    double seconds = 60.0;
+    const char* input = nullptr;
+    double spacing_mm = 390.0;
+
+    for (int i = 1; i < argc; i++) {
+        std::string a = argv[i];
+        auto next = [&]() -> const char* {
+            if (i + 1 >= argc) { std::fprintf(stderr, "missing value for %s\n", a.c_str()); std::exit(2); }
+            return argv[++i];
+        };
+        if (a == "--beams") { long n = std::strtol(next(), nullptr, 0); beams = n > 0 ? (size_t)n : 0; }
+        else if (a == "--channels") cfg.geometry.channels = std::atoi(next());
+        else if (a == "--block") cfg.block_frames = std::strtoul(next(), nullptr, 0);
+        else if (a == "--seconds") seconds = std::atof(next());
+        else if (a == "--type") cfg.type = std::strcmp(next(), "fas") == 0 ? BeamType::FilterAndSum : BeamType::DelayAndSum;
+        else if (a == "--taps") cfg.fir_taps = std::atoi(next());
+        else if (a == "--threads") cfg.threads = std::atoi(next());
+        else if (a == "--temp") cfg.geometry.temperature_c = std::atof(next());
+        else if (a == "--spacing") spacing_mm = std::atof(next());
+        else if (a == "--scalar") cfg.use_simd = false;
+        else if (a == "--input") input = next();
+        else { std::fprintf(stderr, "unknown option %s\n", a.c_str()); return 2; }
+    }
+    if (beams == 0 || cfg.geometry.channels < 1) {
+        std::fprintf(stderr, "usage: beam_bench [--beams N] [--channels M] ..., N and M must be at least 1\n");
+        return 2;
+    }
+    cfg.geometry.spacing_m = spacing_mm / 1000.0;
+    for (size_t b = 0; b < beams; b++) {                               // fan the beams evenly over -90..+90 degrees
+        double frac = beams > 1 ? (double)b / (beams - 1) : 0.5;
+        cfg.steer_angles_rad.push_back((frac - 0.5) * 3.14159265358979);
+    }
+
+    std::vector<int32_t> data = input ? load_input(input, cfg.geometry.channels)
+                                      : synthetic_input(cfg.geometry, (size_t)cfg.geometry.sample_rate);
+    size_t data_frames = data.size() / cfg.geometry.channels;
+    if (data_frames < cfg.block_frames) {
+        std::fprintf(stderr, "input holds fewer than one block of frames\n");
+        return 1;
+    }
+
+    Beamformer bf(cfg);
+    size_t total_blocks = (size_t)(seconds * cfg.geometry.sample_rate / cfg.block_frames);
+    size_t blocks_in_data = data_frames / cfg.block_frames;
+
+    auto start = std::chrono::steady_clock::now();
+    double sink = 0.0;
+    for (size_t i = 0; i < total_blocks; i++) {
+        bf.process(&data[(i % blocks_in_data) * cfg.block_frames * cfg.geometry.channels]);
+        sink += bf.beam(i % beams)[0];                                 // keep the work observable
+    }
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    double frames = (double)total_blocks * cfg.block_frames;
+    double audio_s = frames / cfg.geometry.sample_rate;
+    std::printf("kernels          %s\n", cfg.use_simd && simd_available() ? "avx2" : "scalar");
+    std::printf("beam type        %s\n", cfg.type == BeamType::DelayAndSum ? "delay-and-sum" : "filter-and-sum");
+    std::printf("beams x channels %zu x %d\n", beams, cfg.geometry.channels);
+    std::printf("block frames     %zu\n", cfg.block_frames);
+    std::printf("speed of sound   %.1f m/s, max delay %.2f samples\n", cfg.geometry.speed_of_sound(), cfg.geometry.max_steering_delay());
+    std::printf("audio processed  %.1f s in %.3f s  (%.1fx real time)\n", audio_s, elapsed, audio_s / elapsed);
+    std::printf("throughput       %.1f M beam-channel-samples/s\n", frames * beams * cfg.geometry.channels / elapsed / 1e6);
+    std::printf("per block        %.2f us\n", elapsed / total_blocks * 1e6);
+    if (sink == 12345.678) std::printf(" \n");
+    return 0;
+}
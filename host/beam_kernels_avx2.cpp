@@ -0,0 +1,118 @@
+/*
+AVX2/FMA kernels for the host beamforming library.
+G. Whaley
+
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (C) 2025 The Whaley Group
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ *
+ */
+
+//  This file is compiled with -mavx2 -mfma and is only called after
+//  simd_available() has confirmed the CPU supports both.
+
+#include "beamformer.h"
+
+#include <immintrin.h>
+
+namespace micarray {
+namespace kernels {
+
+void delay_accumulate_avx2(float* out, const float* x, size_t frames, int d, float w0, float w1) {
+    const float* x0 = x - d;
+    const float* x1 = x - d - 1;
+    __m256 vw0 = _mm256_set1_ps(w0);
+    __m256 vw1 = _mm256_set1_ps(w1);
+    size_t n = 0;
+    for (; n + 8 <= frames; n += 8) {
+        __m256 acc = _mm256_loadu_ps(out + n);
+        acc = _mm256_fmadd_ps(vw0, _mm256_loadu_ps(x0 + n), acc);
+        acc = _mm256_fmadd_ps(vw1, _mm256_loadu_ps(x1 + n), acc);
+        _mm256_storeu_ps(out + n, acc);
+    }
+    for (; n < frames; n++) {
+        out[n] += w0 * x0[n] + w1 * x1[n];
+    }
+}
+
+//  Four accumulators of 8 outputs each stay in registers across the whole tap loop,
+//  so each output is loaded and stored once however long the filter is.
+void fir_accumulate_avx2(float* out, const float* x, size_t frames, const float* h, int taps) {
+    size_t n = 0;
+    for (; n + 32 <= frames; n += 32) {
+        __m256 a0 = _mm256_loadu_ps(out + n);
+        __m256 a1 = _mm256_loadu_ps(out + n + 8);
+        __m256 a2 = _mm256_loadu_ps(out + n + 16);
+        __m256 a3 = _mm256_loadu_ps(out + n + 24);
+        for (int k = 0; k < taps; k++) {
+            __m256 hk = _mm256_broadcast_ss(h + k);
+            const float* xk = x + n - k;
+            a0 = _mm256_fmadd_ps(hk, _mm256_loadu_ps(xk), a0);
+            a1 = _mm256_fmadd_ps(hk, _mm256_loadu_ps(xk + 8), a1);
+            a2 = _mm256_fmadd_ps(hk, _mm256_loadu_ps(xk + 16), a2);
+            a3 = _mm256_fmadd_ps(hk, _mm256_loadu_ps(xk + 24), a3);
+        }
+        _mm256_storeu_ps(out + n, a0);
+        _mm256_storeu_ps(out + n + 8, a1);
+        _mm256_storeu_ps(out + n + 16, a2);
+        _mm256_storeu_ps(out + n + 24, a3);
+    }
+    for (; n + 8 <= frames; n += 8) {
+        __m256 a = _mm256_loadu_ps(out + n);
+        for (int k = 0; k < taps; k++) {
+            a = _mm256_fmadd_ps(_mm256_broadcast_ss(h + k), _mm256_loadu_ps(x + n - k), a);
+        }
+        _mm256_storeu_ps(out + n, a);
+    }
+    if (n < frames) fir_accumulate(out + n, x + n, frames - n, h, taps);
+}
+
+//  The device format is two channels, so that case gets a shuffle kernel: four
+//  L/R frames per 256 bit load are permuted to LLLL RRRR and split.  Other channel
+//  counts fall back to the strided scalar loop.
+void deinterleave_se32_avx2(const int32_t* interleaved, size_t frames, int channels, float* const* planar) {
+    if (channels != 2) {
+        deinterleave_se32(interleaved, frames, channels, planar);
+        return;
+    }
+    const __m256i order = _mm256_setr_epi32(0, 2, 4, 6, 1, 3, 5, 7);
+    const __m256i mask = _mm256_set1_epi32((int)0xFFFFFF00);
+    const __m256 scale = _mm256_set1_ps(1.0f / 2147483648.0f);
+    float* left = planar[0];
+    float* right = planar[1];
+    size_t n = 0;
+    for (; n + 4 <= frames; n += 4) {
+        __m256i v = _mm256_loadu_si256((const __m256i*)(interleaved + 2 * n));
+        v = _mm256_permutevar8x32_epi32(_mm256_and_si256(v, mask), order);
+        __m256 f = _mm256_mul_ps(_mm256_cvtepi32_ps(v), scale);
+        _mm_storeu_ps(left + n, _mm256_castps256_ps128(f));
+        _mm_storeu_ps(right + n, _mm256_extractf128_ps(f, 1));
+    }
+    if (n < frames) {
+        float* tail[2] = { left + n, right + n };
+        deinterleave_se32(interleaved + 2 * n, frames - n, 2, tail);
+    }
+}
+
+}  // namespace kernels
+}  // namespace micarray
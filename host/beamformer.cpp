@@ -0,0 +1,328 @@
+/*
+Host-side beamforming library for the MicArray USB microphone.
+G. Whaley
+
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (C) 2025 The Whaley Group
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ *
+ */
+
+#include "beamformer.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <condition_variable>
+#include <cstring>
+#include <functional>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+
+namespace micarray {
+
+static const double PI = 3.14159265358979323846;
+static const float SE32_SCALE = 1.0f / 2147483648.0f;          // full scale 32 bit word maps to 1.0
+static const uint32_t SE32_MASK = 0xFFFFFF00u;                  // bits 0-7 are undefined from the microphone
+static const size_t ROW_ALIGN = 8;                              // floats, keeps each planar row 32 byte aligned
+
+
+SensorReport SensorReport::decode(const uint8_t* data, size_t len) {
+    SensorReport r;
+    if (len >= 2) r.temperature_centi_c = (int16_t)(data[0] | (data[1] << 8));
+    if (len >= 4) r.mic_distance_mm = (int16_t)(data[2] | (data[3] << 8));
+    return r;
+}
+
+
+ArrayGeometry ArrayGeometry::from_report(const SensorReport& report, int channels, double sample_rate) {
+    ArrayGeometry g;
+    g.channels = channels;
+    g.spacing_m = report.mic_distance_m();
+    g.temperature_c = report.temperature_c();
+    g.sample_rate = sample_rate;
+    return g;
+}
+
+double ArrayGeometry::speed_of_sound() const {
+    return 331.3 * std::sqrt(1.0 + temperature_c / 273.15);
+}
+
+double ArrayGeometry::element_position(int ch) const {
+    return (ch - (channels - 1) / 2.0) * spacing_m;
+}
+
+double ArrayGeometry::steering_delay(int ch, double angle_rad) const {
+    // a wavefront from angle_rad reaches element ch early by x*sin(angle)/c, so delay
+    // that element by the same amount plus half the aperture to keep delays positive
+    double half_aperture = max_steering_delay() / 2.0;
+    return element_position(ch) * std::sin(angle_rad) / speed_of_sound() * sample_rate + half_aperture;
+}
+
+double ArrayGeometry::max_steering_delay() const {
+    return (channels - 1) * spacing_m / speed_of_sound() * sample_rate;
+}
+
+
+void deinterleave_se32(const int32_t* interleaved, size_t frames, int channels, float* const* planar) {
+    for (int ch = 0; ch < channels; ch++) {
+        float* dst = planar[ch];
+        const int32_t* src = interleaved + ch;
+        for (size_t n = 0; n < frames; n++) {
+            dst[n] = (float)(int32_t)((uint32_t)src[n * channels] & SE32_MASK) * SE32_SCALE;
+        }
+    }
+}
+
+bool simd_available() {
+#if defined(MICARRAY_HAVE_AVX2)
+    return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#else
+    return false;
+#endif
+}
+
+
+namespace kernels {
+
+void delay_accumulate(float* out, const float* x, size_t frames, int d, float w0, float w1) {
+    const float* x0 = x - d;
+    const float* x1 = x - d - 1;
+    for (size_t n = 0; n < frames; n++) {
+        out[n] += w0 * x0[n] + w1 * x1[n];
+    }
+}
+
+void fir_accumulate(float* out, const float* x, size_t frames, const float* h, int taps) {
+    for (size_t n = 0; n < frames; n++) {
+        float acc = 0.0f;
+        for (int k = 0; k < taps; k++) {
+            acc += h[k] * x[(ptrdiff_t)n - k];
+        }
+        out[n] += acc;
+    }
+}
+
+void scale(float* out, size_t frames, float gain) {
+    for (size_t n = 0; n < frames; n++) {
+        out[n] *= gain;
+    }
+}
+
+#if !defined(MICARRAY_HAVE_AVX2)
+// never selected at run time when not compiled in, see simd_available()
+void delay_accumulate_avx2(float* out, const float* x, size_t frames, int d, float w0, float w1) {
+    delay_accumulate(out, x, frames, d, w0, w1);
+}
+void fir_accumulate_avx2(float* out, const float* x, size_t frames, const float* h, int taps) {
+    fir_accumulate(out, x, frames, h, taps);
+}
+void deinterleave_se32_avx2(const int32_t* interleaved, size_t frames, int channels, float* const* planar) {
+    deinterleave_se32(interleaved, frames, channels, planar);
+}
+#endif
+
+}  // namespace kernels
+
+
+//  Minimal fork-join pool.  The caller thread takes part in the work so a pool
+//  of one thread costs nothing over a plain loop.
+class ThreadPool {
+public:
+    explicit ThreadPool(unsigned threads) {
+        for (unsigned i = 1; i < threads; i++) {
+            workers_.emplace_back([this] { worker(); });
+        }
+    }
+
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        start_cv_.notify_all();
+        for (auto& t : workers_) t.join();
+    }
+
+    void parallel_for(size_t count, const std::function<void(size_t)>& fn) {
+        if (workers_.empty() || count < 2) {
+            for (size_t i = 0; i < count; i++) fn(i);
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            job_ = &fn;
+            count_ = count;
+            next_.store(0);
+            busy_ = workers_.size();
+            generation_++;
+        }
+        start_cv_.notify_all();
+        run_items();
+        std::unique_lock<std::mutex> lock(mutex_);
+        done_cv_.wait(lock, [this] { return busy_ == 0; });
+        job_ = nullptr;
+    }
+
+private:
+    void run_items() {
+        for (size_t i = next_.fetch_add(1); i < count_; i = next_.fetch_add(1)) {
+            (*job_)(i);
+        }
+    }
+
+    void worker() {
+        uint64_t seen = 0;
+        while (true) {
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                start_cv_.wait(lock, [&] { return stop_ || generation_ != seen; });
+                if (stop_) return;
+                seen = generation_;
+            }
+            run_items();
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (--busy_ == 0) done_cv_.notify_one();
+        }
+    }
+
+    std::vector<std::thread> workers_;
+    std::mutex mutex_;
+    std::condition_variable start_cv_;
+    std::condition_variable done_cv_;
+    const std::function<void(size_t)>* job_ = nullptr;
+    size_t count_ = 0;
+    std::atomic<size_t> next_{0};
+    size_t busy_ = 0;
+    uint64_t generation_ = 0;
+    bool stop_ = false;
+};
+
+
+Beamformer::Beamformer(const BeamformerConfig& config)
+    : config_(config), simd_(config.use_simd && simd_available()), history_(0), stride_(0) {
+    if (config_.geometry.channels < 1) throw std::invalid_argument("beamformer needs at least one channel");
+    if (config_.block_frames == 0) throw std::invalid_argument("block_frames must be non-zero");
+    if (config_.type == BeamType::FilterAndSum && config_.fir_taps < 2) throw std::invalid_argument("fir_taps must be at least 2");
+
+    unsigned threads = config_.threads ? config_.threads : std::max(1u, std::thread::hardware_concurrency());
+    pool_.reset(new ThreadPool(threads));
+    output_.assign(beams() * config_.block_frames, 0.0f);
+    update_geometry(config_.geometry);
+}
+
+Beamformer::~Beamformer() = default;
+
+void Beamformer::update_geometry(const ArrayGeometry& geometry) {
+    if (geometry.channels != config_.geometry.channels) throw std::invalid_argument("channel count cannot change");
+    config_.geometry = geometry;
+
+    // keep enough history for the longest steering delay plus the FIR span, with
+    // headroom so small temperature changes do not force a reallocation
+    size_t taps = config_.type == BeamType::FilterAndSum ? (size_t)config_.fir_taps : 1;
+    size_t needed = (size_t)std::ceil(geometry.max_steering_delay()) + taps + 1;
+    if (needed > history_) {
+        history_ = (needed + needed / 4 + ROW_ALIGN - 1) / ROW_ALIGN * ROW_ALIGN;
+        stride_ = (history_ + config_.block_frames + ROW_ALIGN - 1) / ROW_ALIGN * ROW_ALIGN;
+        planar_store_.assign(stride_ * channels() + ROW_ALIGN, 0.0f);
+        float* base = planar_store_.data();
+        base += (ROW_ALIGN - ((uintptr_t)base / sizeof(float)) % ROW_ALIGN) % ROW_ALIGN;
+        planar_.resize(channels());
+        for (int ch = 0; ch < channels(); ch++) planar_[ch] = base + ch * stride_;
+    }
+
+    size_t n = beams() * channels();
+    delay_int_.resize(n);
+    delay_frac_.resize(n);
+    for (size_t b = 0; b < beams(); b++) {
+        for (int ch = 0; ch < channels(); ch++) {
+            double delay = geometry.steering_delay(ch, config_.steer_angles_rad[b]);
+            double whole = std::floor(delay);
+            delay_int_[b * channels() + ch] = (int)whole;
+            delay_frac_[b * channels() + ch] = (float)(delay - whole);
+        }
+    }
+    if (config_.type == BeamType::FilterAndSum) design_filters();
+}
+
+//  Windowed-sinc fractional delay filters.  The integer part of the steering delay
+//  is applied by offsetting the input pointer, the FIR supplies the fraction.  Every
+//  filter has the same bulk delay of fir_taps/2 - 1 samples so the beams stay aligned.
+void Beamformer::design_filters() {
+    int taps = config_.fir_taps;
+    taps_.assign(beams() * channels() * taps, 0.0f);
+    double centre = taps / 2 - 1;
+    for (size_t i = 0; i < beams() * (size_t)channels(); i++) {
+        float* h = &taps_[i * taps];
+        double sum = 0.0;
+        for (int k = 0; k < taps; k++) {
+            double t = k - centre - delay_frac_[i];
+            double sinc = std::fabs(t) < 1e-9 ? 1.0 : std::sin(PI * t) / (PI * t);
+            double window = 0.5 - 0.5 * std::cos(2.0 * PI * (k + 0.5 - delay_frac_[i]) / taps);    // Hann, shifted with the fraction
+            h[k] = (float)(sinc * window);
+            sum += h[k];
+        }
+        for (int k = 0; k < taps; k++) h[k] = (float)(h[k] / sum);        // unity gain at DC
+    }
+}
+
+void Beamformer::set_filter(size_t beam, int ch, const float* taps) {
+    if (config_.type != BeamType::FilterAndSum) throw std::logic_error("set_filter needs a filter-and-sum beamformer");
+    std::memcpy(&taps_[(beam * channels() + ch) * config_.fir_taps], taps, config_.fir_taps * sizeof(float));
+}
+
+void Beamformer::form_beam(size_t b) {
+    size_t frames = config_.block_frames;
+    float* out = &output_[b * frames];
+    std::fill(out, out + frames, 0.0f);
+    for (int ch = 0; ch < channels(); ch++) {
+        size_t i = b * channels() + ch;
+        const float* x = planar_[ch] + history_;
+        if (config_.type == BeamType::DelayAndSum) {
+            float f = delay_frac_[i];
+            if (simd_) kernels::delay_accumulate_avx2(out, x, frames, delay_int_[i], 1.0f - f, f);
+            else kernels::delay_accumulate(out, x, frames, delay_int_[i], 1.0f - f, f);
+        } else {
+            const float* h = &taps_[i * config_.fir_taps];
+            if (simd_) kernels::fir_accumulate_avx2(out, x - delay_int_[i], frames, h, config_.fir_taps);
+            else kernels::fir_accumulate(out, x - delay_int_[i], frames, h, config_.fir_taps);
+        }
+    }
+    kernels::scale(out, frames, 1.0f / channels());
+}
+
+void Beamformer::process(const int32_t* interleaved) {
+    size_t frames = config_.block_frames;
+    for (int ch = 0; ch < channels(); ch++) {                       // slide the tail of the last block into the history
+        std::memmove(planar_[ch], planar_[ch] + frames, history_ * sizeof(float));
+    }
+    std::vector<float*> dst(channels());
+    for (int ch = 0; ch < channels(); ch++) dst[ch] = planar_[ch] + history_;
+    if (simd_) kernels::deinterleave_se32_avx2(interleaved, frames, channels(), dst.data());
+    else deinterleave_se32(interleaved, frames, channels(), dst.data());
+
+    pool_->parallel_for(beams(), [this](size_t b) { form_beam(b); });
+}
+
+}  // namespace micarray
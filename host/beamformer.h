@@ -0,0 +1,165 @@
+/*
+Host-side beamforming library for the MicArray USB microphone.
+G. Whaley
+
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (C) 2025 The Whaley Group
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ *
+ */
+
+/*
+The device streams SE_32 samples interleaved by channel, exactly as they sit in
+each firmware sample_ring[block][frame][channel] block:  L0 R0 L1 R1 L2 R2 ...
+Each 32 bit word holds the 24 bit microphone sample in bits 31-8.
+
+The beamformer takes blocks of that interleaved stream, deinterleaves them into
+planar float channels (one contiguous run of samples per microphone, which is
+what the vector kernels want), and forms any number of beams steered at fixed
+angles from broadside of the linear array.  Two beam types are provided:
+
+  delay-and-sum   each channel is delayed by the integer+fractional steering delay
+                  (linear interpolation) and the channels are averaged.
+  filter-and-sum  each channel is passed through its own FIR filter per beam and
+                  the filter outputs are averaged.  By default the filters are
+                  windowed-sinc fractional delays, but any taps may be loaded.
+
+Microphone spacing and the speed of sound come from the HID sensor report
+(temperature in degrees C * 100, spacing in mm) so the steering delays track
+the environment the array is in.
+*/
+
+#ifndef _MICARRAY_BEAMFORMER_H_
+#define _MICARRAY_BEAMFORMER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace micarray {
+
+// decoded contents of HID report ID 1 as returned by tud_hid_get_report_cb()
+struct SensorReport {
+    int16_t temperature_centi_c = 2000;         // degrees C * 100
+    int16_t mic_distance_mm = 390;              // spacing between adjacent microphones
+
+    double temperature_c() const { return temperature_centi_c / 100.0; }
+    double mic_distance_m() const { return mic_distance_mm / 1000.0; }
+
+    // decode the report data bytes (report ID byte already stripped), LSB first
+    static SensorReport decode(const uint8_t* data, size_t len);
+};
+
+// geometry of a uniform linear array, element 0 at one end
+struct ArrayGeometry {
+    int channels = 2;
+    double spacing_m = 0.390;
+    double temperature_c = 20.0;
+    double sample_rate = 48000.0;
+
+    static ArrayGeometry from_report(const SensorReport& report, int channels, double sample_rate);
+
+    double speed_of_sound() const;              // m/s, dry air at temperature_c
+    double element_position(int ch) const;      // metres from the array centre
+    double steering_delay(int ch, double angle_rad) const;   // samples, always >= 0
+    double max_steering_delay() const;          // samples, largest delay any beam can ask for
+};
+
+enum class BeamType { DelayAndSum, FilterAndSum };
+
+struct BeamformerConfig {
+    ArrayGeometry geometry;
+    BeamType type = BeamType::DelayAndSum;
+    std::vector<double> steer_angles_rad;       // one beam per angle, 0 = broadside
+    size_t block_frames = 480;                  // frames handed to process() each call
+    int fir_taps = 32;                          // filter-and-sum only, length of each FIR
+    unsigned threads = 0;                       // 0 = one per hardware thread
+    bool use_simd = true;                       // use AVX2 kernels when the CPU has them
+};
+
+// convert interleaved SE_32 frames to planar float in the range [-1, 1)
+void deinterleave_se32(const int32_t* interleaved, size_t frames, int channels, float* const* planar);
+
+// true when the AVX2 kernels were compiled in and the running CPU supports them
+bool simd_available();
+
+class ThreadPool;
+
+class Beamformer {
+public:
+    explicit Beamformer(const BeamformerConfig& config);
+    ~Beamformer();
+
+    Beamformer(const Beamformer&) = delete;
+    Beamformer& operator=(const Beamformer&) = delete;
+
+    // Process block_frames interleaved frames.  The beam outputs for the block are
+    // available from beam() until the next call.
+    void process(const int32_t* interleaved);
+
+    // re-derive steering delays and default filters, e.g. after a new temperature report
+    void update_geometry(const ArrayGeometry& geometry);
+
+    // replace the filter-and-sum taps for one beam/channel pair (fir_taps values)
+    void set_filter(size_t beam, int ch, const float* taps);
+
+    size_t beams() const { return config_.steer_angles_rad.size(); }
+    int channels() const { return config_.geometry.channels; }
+    size_t block_frames() const { return config_.block_frames; }
+    const float* beam(size_t b) const { return &output_[b * config_.block_frames]; }
+    const float* channel(int ch) const { return planar_[ch] + history_; }
+
+private:
+    void design_filters();
+    void form_beam(size_t b);
+
+    BeamformerConfig config_;
+    bool simd_;
+    size_t history_;                            // samples of previous blocks kept ahead of each channel
+    size_t stride_;                             // floats per planar channel row (history + block, padded)
+    std::vector<float> planar_store_;
+    std::vector<float*> planar_;
+    std::vector<float> output_;                 // beams x block_frames
+    std::vector<int> delay_int_;                // beams x channels, delay-and-sum integer part
+    std::vector<float> delay_frac_;             // beams x channels, delay-and-sum fractional part
+    std::vector<float> taps_;                   // beams x channels x fir_taps, filter-and-sum
+    std::unique_ptr<ThreadPool> pool_;
+};
+
+// kernel entry points, portable C++ and AVX2 versions share these signatures
+namespace kernels {
+    // out[n] += w0 * x[n - d] + w1 * x[n - d - 1] for n in [0, frames)
+    void delay_accumulate(float* out, const float* x, size_t frames, int d, float w0, float w1);
+    // out[n] += sum_k h[k] * x[n - k] for n in [0, frames)
+    void fir_accumulate(float* out, const float* x, size_t frames, const float* h, int taps);
+    void scale(float* out, size_t frames, float gain);
+
+    void delay_accumulate_avx2(float* out, const float* x, size_t frames, int d, float w0, float w1);
+    void fir_accumulate_avx2(float* out, const float* x, size_t frames, const float* h, int taps);
+    void deinterleave_se32_avx2(const int32_t* interleaved, size_t frames, int channels, float* const* planar);
+}
+
+}  // namespace micarray
+
+#endif
@@ -0,0 +1,243 @@
+/*
+Memory-mapped capture ring shared by MicArray host processes.
+G. Whaley
+
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (C) 2025 The Whaley Group
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ *
+ */
+
+#include "capture_ring.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <new>
+
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace micarray {
+
+static uint64_t round_up_pow2(uint64_t v) {
+    uint64_t p = 1;
+    while (p < v) p <<= 1;
+    return p;
+}
+
+
+RingWriter::~RingWriter() {
+    close();
+}
+
+bool RingWriter::create(const std::string& path, uint32_t channels, uint32_t sample_rate, uint64_t capacity_frames) {
+    close();
+    if (channels == 0 || capacity_frames == 0) return false;
+    capacity_frames = round_up_pow2(capacity_frames);
+
+    fd_ = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+    if (fd_ < 0) return false;
+    if (flock(fd_, LOCK_EX | LOCK_NB) != 0) {                         // a reader or another writer has it
+        int err = errno == EWOULDBLOCK ? EBUSY : errno;
+        close();
+        errno = err;
+        return false;
+    }
+    map_bytes_ = RING_HEADER_BYTES + capacity_frames * channels * sizeof(int32_t);
+    if (ftruncate(fd_, 0) != 0 || ftruncate(fd_, (off_t)map_bytes_) != 0) {
+        close();
+        return false;
+    }
+    void* map = mmap(nullptr, map_bytes_, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+    if (map == MAP_FAILED) {
+        close();
+        return false;
+    }
+
+    header_ = new (map) RingHeader();
+    header_->version = 1;
+    header_->channels = channels;
+    header_->sample_rate = sample_rate;
+    header_->bytes_per_sample = sizeof(int32_t);
+    header_->capacity_frames = capacity_frames;
+    header_->write_reserved.store(0, std::memory_order_relaxed);
+    header_->write_committed.store(0, std::memory_order_relaxed);
+    header_->meta_seq.store(0, std::memory_order_relaxed);
+    data_ = (int32_t*)((char*)map + RING_HEADER_BYTES);
+
+    std::atomic_thread_fence(std::memory_order_release);
+    std::memcpy(header_->magic, RING_MAGIC, sizeof(RING_MAGIC));       // readers refuse the file until the magic is present
+    msync(map, RING_HEADER_BYTES, MS_SYNC);
+    flock(fd_, LOCK_SH);                                                // readers may open it now, writers still may not
+    return true;
+}
+
+void RingWriter::close() {
+    if (header_) munmap(header_, map_bytes_);
+    if (fd_ >= 0) ::close(fd_);
+    header_ = nullptr;
+    data_ = nullptr;
+    fd_ = -1;
+}
+
+int32_t* RingWriter::acquire(size_t wanted, size_t* contiguous) {
+    uint64_t cap = header_->capacity_frames;
+    uint64_t w = header_->write_committed.load(std::memory_order_relaxed);
+    uint64_t slot = w & (cap - 1);
+    size_t n = (size_t)std::min<uint64_t>(wanted, cap - slot);
+
+    // announce the frames about to be overwritten before touching them
+    header_->write_reserved.store(w + n, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    *contiguous = n;
+    return data_ + slot * header_->channels;
+}
+
+void RingWriter::commit(size_t frames) {
+    uint64_t w = header_->write_committed.load(std::memory_order_relaxed);
+    header_->write_committed.store(w + frames, std::memory_order_release);
+}
+
+void RingWriter::write(const int32_t* frames, size_t count) {
+    while (count) {
+        size_t n;
+        int32_t* dst = acquire(count, &n);
+        std::memcpy(dst, frames, n * header_->channels * sizeof(int32_t));
+        commit(n);
+        frames += n * header_->channels;
+        count -= n;
+    }
+}
+
+void RingWriter::set_metadata(const RingMetadata& meta) {
+    uint32_t seq = header_->meta_seq.load(std::memory_order_relaxed);
+    header_->meta_seq.store(seq + 1, std::memory_order_relaxed);        // odd: update in progress
+    std::atomic_thread_fence(std::memory_order_release);
+    header_->meta_temperature_centi_c = meta.temperature_centi_c;
+    header_->meta_mic_distance_mm = meta.mic_distance_mm;
+    header_->meta_frame = meta.frame;
+    header_->meta_time_ns = meta.time_ns;
+    header_->meta_seq.store(seq + 2, std::memory_order_release);
+}
+
+
+RingReader::~RingReader() {
+    close();
+}
+
+bool RingReader::open(const std::string& path) {
+    close();
+    fd_ = ::open(path.c_str(), O_RDONLY);
+    if (fd_ < 0) return false;
+    if (flock(fd_, LOCK_SH | LOCK_NB) != 0) {                         // the writer is still creating it
+        close();
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd_, &st) != 0 || (size_t)st.st_size < RING_HEADER_BYTES) {
+        close();
+        return false;
+    }
+    map_bytes_ = (size_t)st.st_size;
+    void* map = mmap(nullptr, map_bytes_, PROT_READ, MAP_SHARED, fd_, 0);
+    if (map == MAP_FAILED) {
+        close();
+        return false;
+    }
+    header_ = (const RingHeader*)map;
+    if (std::memcmp(header_->magic, RING_MAGIC, sizeof(RING_MAGIC)) != 0 ||
+        RING_HEADER_BYTES + header_->capacity_frames * header_->channels * sizeof(int32_t) > map_bytes_) {
+        close();
+        return false;
+    }
+    data_ = (const int32_t*)((const char*)map + RING_HEADER_BYTES);
+    seek_newest();
+    return true;
+}
+
+void RingReader::close() {
+    if (header_) munmap((void*)header_, map_bytes_);
+    if (fd_ >= 0) ::close(fd_);
+    header_ = nullptr;
+    data_ = nullptr;
+    fd_ = -1;
+}
+
+void RingReader::seek_newest() {
+    cursor_ = header_->write_committed.load(std::memory_order_acquire);
+}
+
+void RingReader::seek_oldest() {
+    uint64_t w = header_->write_reserved.load(std::memory_order_acquire);       // slots up to here may already be in flux
+    uint64_t cap = header_->capacity_frames;
+    cursor_ = w > cap ? w - cap : 0;
+}
+
+size_t RingReader::available() const {
+    return (size_t)(header_->write_committed.load(std::memory_order_acquire) - cursor_);
+}
+
+const int32_t* RingReader::view(size_t max_frames, size_t* frames) {
+    uint64_t cap = header_->capacity_frames;
+    uint64_t w = header_->write_committed.load(std::memory_order_acquire);
+    if (w - cursor_ > cap) {                                    // lapped while idle, jump to the oldest intact frame
+        overruns_++;
+        cursor_ = w - cap;
+    }
+    uint64_t slot = cursor_ & (cap - 1);
+    *frames = (size_t)std::min<uint64_t>({ (uint64_t)max_frames, w - cursor_, cap - slot });
+    return data_ + slot * header_->channels;
+}
+
+bool RingReader::release(size_t frames) {
+    std::atomic_thread_fence(std::memory_order_acquire);        // sample reads above complete before the check
+    uint64_t reserved = header_->write_reserved.load(std::memory_order_relaxed);
+    uint64_t cap = header_->capacity_frames;
+    if (reserved > cap && reserved - cap > cursor_) {
+        overruns_++;
+        cursor_ = reserved - cap;
+        return false;
+    }
+    cursor_ += frames;
+    return true;
+}
+
+bool RingReader::metadata(RingMetadata* meta) const {
+    for (int tries = 0; tries < 1000; tries++) {
+        uint32_t before = header_->meta_seq.load(std::memory_order_acquire);
+        if (before & 1) continue;
+        meta->temperature_centi_c = header_->meta_temperature_centi_c;
+        meta->mic_distance_mm = header_->meta_mic_distance_mm;
+        meta->frame = header_->meta_frame;
+        meta->time_ns = header_->meta_time_ns;
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (header_->meta_seq.load(std::memory_order_relaxed) == before) return before != 0;
+    }
+    return false;
+}
+
+}  // namespace micarray
@@ -0,0 +1,183 @@
+/*
+Memory-mapped capture ring shared by MicArray host processes.
+G. Whaley
+
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (C) 2025 The Whaley Group
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ *
+ */
+
+/*
+One capture process writes the device stream into a ring held in a memory-mapped
+file, and any number of other processes (recorders, beamformers, monitors) map
+the same file read-only and consume the samples in place.  Nothing is copied
+between processes and the writer never waits on a reader.
+
+File layout:
+    page 0      RingHeader - format, frame counters and sensor metadata
+    page 1...   capacity_frames x channels SE_32 samples, interleaved exactly as
+                the device sends them
+
+Protocol (single writer, many readers):
+    The writer bumps write_reserved before it overwrites ring slots and bumps
+    write_committed after the new frames are in place.  A reader may use frames
+    [cursor, write_committed).  Because the writer does not know about readers a
+    slow reader can be lapped; after using a view the reader checks write_reserved
+    and, if the writer has reached into the frames it was looking at, the view is
+    reported as overrun and the reader skips ahead.
+
+    The sensor metadata (temperature, mic spacing) is a seqlock: meta_seq is odd
+    while the writer is updating it and readers retry until they see the same even
+    value before and after copying the fields.  meta_frame records the ring frame
+    index at which the report was taken so consumers can line geometry up with
+    the samples.
+
+    Truncating the file under a mapping makes every access to it fault, so the
+    file is flock()ed: readers hold a shared lock while they have it mapped, and
+    the writer takes an exclusive one while it creates the ring and keeps a shared
+    one after.  create() refuses, with errno EBUSY, a ring that another writer or
+    any reader still has open, and open() refuses a ring that is being created.
+*/
+
+#ifndef _MICARRAY_CAPTURE_RING_H_
+#define _MICARRAY_CAPTURE_RING_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace micarray {
+
+static const char RING_MAGIC[8] = { 'M', 'I', 'C', 'R', 'I', 'N', 'G', '1' };
+static const size_t RING_HEADER_BYTES = 4096;
+
+struct RingMetadata {
+    int16_t temperature_centi_c = 0;            // degrees C * 100, from HID report 1
+    int16_t mic_distance_mm = 0;                // mic spacing in mm, from HID report 1
+    uint64_t frame = 0;                         // ring frame index when the report was read
+    uint64_t time_ns = 0;                       // CLOCK_REALTIME when the report was read
+};
+
+struct RingHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t channels;
+    uint32_t sample_rate;
+    uint32_t bytes_per_sample;
+    uint64_t capacity_frames;                   // power of two
+
+    alignas(64) std::atomic<uint64_t> write_reserved;    // frames the writer may be touching up to
+    alignas(64) std::atomic<uint64_t> write_committed;   // frames fully written
+
+    alignas(64) std::atomic<uint32_t> meta_seq;
+    int16_t meta_temperature_centi_c;
+    int16_t meta_mic_distance_mm;
+    uint64_t meta_frame;
+    uint64_t meta_time_ns;
+};
+
+static_assert(sizeof(RingHeader) <= RING_HEADER_BYTES, "ring header must fit in the first page");
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "ring counters must be lock free to be shared between processes");
+
+
+class RingWriter {
+public:
+    RingWriter() = default;
+    ~RingWriter();
+    RingWriter(const RingWriter&) = delete;
+    RingWriter& operator=(const RingWriter&) = delete;
+
+    // create (or truncate) the ring file, capacity is rounded up to a power of two;
+    // false with errno EBUSY if another process has the ring open
+    bool create(const std::string& path, uint32_t channels, uint32_t sample_rate, uint64_t capacity_frames);
+    void close();
+
+    // Zero-copy write:  acquire() returns where the next frames go and how many may be
+    // written there contiguously (the ring may wrap sooner than requested).  The source
+    // reads straight into that memory and then commit() publishes what it wrote.
+    int32_t* acquire(size_t wanted, size_t* contiguous);
+    void commit(size_t frames);
+
+    // copying write for sources that already hold the samples elsewhere
+    void write(const int32_t* frames, size_t count);
+
+    void set_metadata(const RingMetadata& meta);
+
+    uint64_t frames_written() const { return header_->write_committed.load(std::memory_order_relaxed); }
+    uint32_t channels() const { return header_->channels; }
+
+private:
+    RingHeader* header_ = nullptr;
+    int32_t* data_ = nullptr;
+    size_t map_bytes_ = 0;
+    int fd_ = -1;
+};
+
+
+class RingReader {
+public:
+    RingReader() = default;
+    ~RingReader();
+    RingReader(const RingReader&) = delete;
+    RingReader& operator=(const RingReader&) = delete;
+
+    // map an existing ring, the cursor starts at the newest frame; false if the file
+    // is missing, not a ring, or still being created
+    bool open(const std::string& path);
+    void close();
+
+    // Frames ready to read at the cursor, up to max_frames and never past the ring wrap.
+    // The pointer addresses the shared mapping directly.
+    const int32_t* view(size_t max_frames, size_t* frames);
+
+    // Advance the cursor past frames taken from view().  Returns false if the writer
+    // lapped the reader while the view was in use; the data just read may be torn and
+    // the cursor has been moved up to the oldest frame still intact.
+    bool release(size_t frames);
+
+    size_t available() const;
+    uint64_t cursor() const { return cursor_; }
+    uint64_t overruns() const { return overruns_; }
+    void seek_newest();
+    void seek_oldest();                         // oldest frame still held in the ring
+
+    bool metadata(RingMetadata* meta) const;
+
+    uint32_t channels() const { return header_->channels; }
+    uint32_t sample_rate() const { return header_->sample_rate; }
+    uint64_t capacity() const { return header_->capacity_frames; }
+
+private:
+    const RingHeader* header_ = nullptr;
+    const int32_t* data_ = nullptr;
+    size_t map_bytes_ = 0;
+    int fd_ = -1;
+    uint64_t cursor_ = 0;
+    uint64_t overruns_ = 0;
+};
+
+}  // namespace micarray
+
+#endif
@@ -0,0 +1,228 @@
+/*
+Sample sources and HID sensor polling for the MicArray capture tools.
+G. Whaley
+
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (C) 2025 The Whaley Group
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ *
+ */
+
+#include "capture_source.h"
+
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <ctime>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+#include <linux/hidraw.h>
+
+#if defined(MICARRAY_HAVE_ALSA)
+#include <alsa/asoundlib.h>
+#endif
+
+namespace micarray {
+
+static const uint8_t SENSOR_REPORT_ID = 1;
+static const size_t SENSOR_REPORT_LEN = 4;          // temperature and mic distance, int16 LSB first
+static const size_t SENSOR_INPUT_LEN = 5;           // interrupt IN report adds a status byte
+
+
+//  Raw SE_32 from a file descriptor.  Partial frames left by a short read are
+//  carried over so a pipe that splits a frame does not shift the channels.
+class FdSource : public CaptureSource {
+public:
+    FdSource(int fd, bool owned, uint32_t channels, uint32_t sample_rate)
+        : fd_(fd), owned_(owned), channels_(channels), sample_rate_(sample_rate) {}
+    ~FdSource() override { if (owned_) ::close(fd_); }
+
+    long read(int32_t* dst, size_t frames) override {
+        size_t frame_bytes = channels_ * sizeof(int32_t);
+        size_t want = frames * frame_bytes;
+        size_t got = 0;
+        while (got < frame_bytes) {                                  // block for at least one whole frame
+            ssize_t n = ::read(fd_, (char*)dst + got, want - got);
+            if (n < 0 && errno == EINTR) continue;
+            if (n < 0) return -1;
+            if (n == 0) return 0;
+            got += (size_t)n;
+        }
+        size_t whole = got / frame_bytes;
+        size_t extra = got - whole * frame_bytes;
+        while (extra) {                                              // finish the frame that was split
+            ssize_t n = ::read(fd_, (char*)dst + got, frame_bytes - extra);
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) return (long)whole;
+            got += (size_t)n;
+            extra = (extra + (size_t)n) % frame_bytes;
+            if (extra == 0) whole++;
+        }
+        return (long)whole;
+    }
+
+    uint32_t channels() const override { return channels_; }
+    uint32_t sample_rate() const override { return sample_rate_; }
+
+private:
+    int fd_;
+    bool owned_;
+    uint32_t channels_;
+    uint32_t sample_rate_;
+};
+
+
+#if defined(MICARRAY_HAVE_ALSA)
+class AlsaSource : public CaptureSource {
+public:
+    AlsaSource(snd_pcm_t* pcm, uint32_t channels, uint32_t sample_rate)
+        : pcm_(pcm), channels_(channels), sample_rate_(sample_rate) {}
+    ~AlsaSource() override { snd_pcm_close(pcm_); }
+
+    long read(int32_t* dst, size_t frames) override {
+        while (true) {
+            snd_pcm_sframes_t n = snd_pcm_readi(pcm_, dst, frames);
+            if (n >= 0) return (long)n;
+            if (snd_pcm_recover(pcm_, (int)n, 1) < 0) return -1;     // xrun or suspend, restart and carry on
+        }
+    }
+
+    uint32_t channels() const override { return channels_; }
+    uint32_t sample_rate() const override { return sample_rate_; }
+
+    static std::unique_ptr<CaptureSource> open(const std::string& device, uint32_t channels, uint32_t sample_rate) {
+        snd_pcm_t* pcm;
+        if (snd_pcm_open(&pcm, device.c_str(), SND_PCM_STREAM_CAPTURE, 0) < 0) return nullptr;
+        if (snd_pcm_set_params(pcm, SND_PCM_FORMAT_S32_LE, SND_PCM_ACCESS_RW_INTERLEAVED,
+                               channels, sample_rate, 0, 100000) < 0) {
+            snd_pcm_close(pcm);
+            return nullptr;
+        }
+        return std::unique_ptr<CaptureSource>(new AlsaSource(pcm, channels, sample_rate));
+    }
+
+private:
+    snd_pcm_t* pcm_;
+    uint32_t channels_;
+    uint32_t sample_rate_;
+};
+#endif
+
+
+std::unique_ptr<CaptureSource> open_source(const std::string& name, uint32_t channels, uint32_t sample_rate) {
+    if (name.compare(0, 5, "alsa:") == 0) {
+#if defined(MICARRAY_HAVE_ALSA)
+        return AlsaSource::open(name.substr(5), channels, sample_rate);
+#else
+        std::fprintf(stderr, "built without ALSA support\n");
+        return nullptr;
+#endif
+    }
+    if (name == "-") return std::unique_ptr<CaptureSource>(new FdSource(0, false, channels, sample_rate));
+    int fd = ::open(name.c_str(), O_RDONLY);
+    if (fd < 0) return nullptr;
+    return std::unique_ptr<CaptureSource>(new FdSource(fd, true, channels, sample_rate));
+}
+
+
+HidPoller::~HidPoller() {
+    stop();
+}
+
+bool HidPoller::read_report(int fd, SensorReport* report) {
+    uint8_t buf[1 + SENSOR_REPORT_LEN] = { SENSOR_REPORT_ID };      // first byte is the report ID, then data LSB first
+    int n = ioctl(fd, HIDIOCGFEATURE(sizeof(buf)), buf);
+    if (n < (int)sizeof(buf)) return false;
+    *report = SensorReport::decode(buf + 1, SENSOR_REPORT_LEN);
+    return true;
+}
+
+bool HidPoller::decode_input(const uint8_t* buf, size_t len, SensorReport* report) {
+    if (len < 1 + SENSOR_REPORT_LEN || buf[0] != SENSOR_REPORT_ID) return false;
+    *report = SensorReport::decode(buf + 1, SENSOR_REPORT_LEN);
+    return true;
+}
+
+bool HidPoller::start(const std::string& hidraw_path, double rate_hz, RingWriter* ring) {
+    stop();
+    fd_ = ::open(hidraw_path.c_str(), O_RDWR);
+    if (fd_ < 0) return false;
+    SensorReport probe;
+    if (rate_hz < 0.0 || !read_report(fd_, &probe)) {
+        ::close(fd_);
+        fd_ = -1;
+        return false;
+    }
+    ring_ = ring;
+    running_ = true;
+    thread_ = std::thread([this, rate_hz] { run(rate_hz); });
+    return true;
+}
+
+void HidPoller::stop() {
+    running_ = false;
+    if (thread_.joinable()) thread_.join();
+    if (fd_ >= 0) ::close(fd_);
+    fd_ = -1;
+}
+
+void HidPoller::publish(const SensorReport& report) {
+    RingMetadata meta;
+    meta.temperature_centi_c = report.temperature_centi_c;
+    meta.mic_distance_mm = report.mic_distance_mm;
+    meta.frame = ring_->frames_written();
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    meta.time_ns = (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+    ring_->set_metadata(meta);
+}
+
+void HidPoller::run(double rate_hz) {
+    if (rate_hz == 0.0) {                                           // device pushes reports on its interrupt endpoint
+        SensorReport first;                                         // current values until the first push arrives
+        if (read_report(fd_, &first)) publish(first);
+        while (running_) {
+            struct pollfd pfd = { fd_, POLLIN, 0 };
+            if (::poll(&pfd, 1, 100) <= 0) continue;                // wake regularly to notice stop()
+            uint8_t buf[1 + SENSOR_INPUT_LEN];
+            ssize_t n = ::read(fd_, buf, sizeof(buf));
+            SensorReport report;
+            if (n > 0 && decode_input(buf, (size_t)n, &report)) publish(report);
+        }
+        return;
+    }
+
+    auto period = std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(1.0 / rate_hz));
+    auto next = std::chrono::steady_clock::now();
+    while (running_) {
+        SensorReport report;
+        if (read_report(fd_, &report)) publish(report);
+        next += period;
+        std::this_thread::sleep_until(next);
+    }
+}
+
+}  // namespace micarray
@@ -0,0 +1,95 @@
+/*
+Sample sources and HID sensor polling for the MicArray capture tools.
+G. Whaley
+
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (C) 2025 The Whaley Group
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ *
+ */
+
+#ifndef _MICARRAY_CAPTURE_SOURCE_H_
+#define _MICARRAY_CAPTURE_SOURCE_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+
+#include "beamformer.h"                 // SensorReport
+#include "capture_ring.h"
+
+namespace micarray {
+
+// Something that delivers interleaved SE_32 frames.  read() fills dst with up to
+// frames frames, blocking until at least one is available; returns the number of
+// frames read, 0 at end of stream, or -1 on error.
+class CaptureSource {
+public:
+    virtual ~CaptureSource() = default;
+    virtual long read(int32_t* dst, size_t frames) = 0;
+    virtual uint32_t channels() const = 0;
+    virtual uint32_t sample_rate() const = 0;
+};
+
+// Open a source by name:
+//    alsa:DEVICE   ALSA capture device, e.g. alsa:hw:MicArray (only when built with ALSA)
+//    -             raw interleaved SE_32 on stdin
+//    PATH          raw interleaved SE_32 file or named pipe
+std::unique_ptr<CaptureSource> open_source(const std::string& name, uint32_t channels, uint32_t sample_rate);
+
+
+// Reads HID report 1 from a hidraw node on its own thread and writes each report
+// into the ring metadata, stamped with the ring frame count at the time of the read.
+// With a positive rate the feature report is polled; with rate 0 the thread waits
+// for the reports the device pushes on its interrupt IN endpoint.
+class HidPoller {
+public:
+    HidPoller() = default;
+    ~HidPoller();
+
+    bool start(const std::string& hidraw_path, double rate_hz, RingWriter* ring);
+    void stop();
+
+    // single synchronous read of report 1, also used by start() to check the device
+    static bool read_report(int fd, SensorReport* report);
+
+    // decode one input report as read() from the hidraw node, report ID first;
+    // false for another report or a short one
+    static bool decode_input(const uint8_t* buf, size_t len, SensorReport* report);
+
+private:
+    void run(double rate_hz);
+    void publish(const SensorReport& report);
+
+    RingWriter* ring_ = nullptr;
+    int fd_ = -1;
+    std::atomic<bool> running_{false};
+    std::thread thread_;
+};
+
+}  // namespace micarray
+
+#endif
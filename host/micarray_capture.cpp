@@ -0,0 +1,124 @@
+/*
+Capture the MicArray stream into a shared memory-mapped ring file.
+G. Whaley
+
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (C) 2025 The Whaley Group
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ *
+ */
+
+/*
+Usage:  micarray_capture --ring FILE [options]
+    --ring FILE        ring file to create, e.g. /dev/shm/micarray0
+    --source NAME      alsa:DEVICE, a raw SE_32 file/pipe, or - for stdin (default -)
+    --channels N       channels in the stream (default 2)
+    --rate HZ          sample rate (default 48000)
+    --seconds S        ring capacity in seconds (default 10)
+    --hid PATH         hidraw node of the MicArray, e.g. /dev/hidraw3
+    --hid-rate HZ      HID feature report polls per second, 0 = use the reports
+                       the device pushes on its interrupt endpoint (default 0)
+
+Samples are read straight into the mapped ring, so the only copy on the host is
+the one the kernel makes out of the USB buffers.
+*/
+
+#include "capture_ring.h"
+#include "capture_source.h"
+
+#include <cerrno>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+using namespace micarray;
+
+static volatile std::sig_atomic_t stop_requested = 0;
+
+static void on_signal(int) {
+    stop_requested = 1;
+}
+
+int main(int argc, char** argv) {
+    std::string ring_path;
+    std::string source_name = "-";
+    std::string hid_path;
+    uint32_t channels = 2;
+    uint32_t rate = 48000;
+    double seconds = 10.0;
+    double hid_rate = 0.0;
+
+    for (int i = 1; i < argc; i++) {
+        std::string a = argv[i];
+        auto next = [&]() -> const char* {
+            if (i + 1 >= argc) { std::fprintf(stderr, "missing value for %s\n", a.c_str()); std::exit(2); }
+            return argv[++i];
+        };
+        if (a == "--ring") ring_path = next();
+        else if (a == "--source") source_name = next();
+        else if (a == "--channels") channels = std::strtoul(next(), nullptr, 0);
+        else if (a == "--rate") rate = std::strtoul(next(), nullptr, 0);
+        else if (a == "--seconds") seconds = std::atof(next());
+        else if (a == "--hid") hid_path = next();
+        else if (a == "--hid-rate") hid_rate = std::atof(next());
+        else { std::fprintf(stderr, "unknown option %s\n", a.c_str()); return 2; }
+    }
+    if (ring_path.empty()) {
+        std::fprintf(stderr, "--ring is required\n");
+        return 2;
+    }
+
+    std::unique_ptr<CaptureSource> source = open_source(source_name, channels, rate);
+    if (!source) {
+        std::fprintf(stderr, "cannot open source %s\n", source_name.c_str());
+        return 1;
+    }
+    RingWriter ring;
+    if (!ring.create(ring_path, channels, rate, (uint64_t)(seconds * rate))) {
+        if (errno == EBUSY) std::fprintf(stderr, "ring %s is open in another process, stop its readers first\n", ring_path.c_str());
+        else std::fprintf(stderr, "cannot create ring %s: %s\n", ring_path.c_str(), std::strerror(errno));
+        return 1;
+    }
+    HidPoller hid;
+    if (!hid_path.empty() && !hid.start(hid_path, hid_rate, &ring)) {
+        std::fprintf(stderr, "cannot read HID report from %s\n", hid_path.c_str());
+        return 1;
+    }
+
+    std::signal(SIGINT, on_signal);
+    std::signal(SIGTERM, on_signal);
+
+    const size_t chunk = rate / 100;                            // 10 ms per read
+    while (!stop_requested) {
+        size_t room;
+        int32_t* dst = ring.acquire(chunk, &room);
+        long n = source->read(dst, room);
+        if (n <= 0) break;
+        ring.commit((size_t)n);
+    }
+    hid.stop();
+    std::fprintf(stderr, "captured %llu frames\n", (unsigned long long)ring.frames_written());
+    return 0;
+}
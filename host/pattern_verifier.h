@@ -0,0 +1,234 @@
+/*
+Checks the firmware test pattern stream frame by frame.
+G. Whaley
+
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (C) 2025 The Whaley Group
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ *
+ */
+
+/*
+PatternVerifier regenerates the pattern from test_pattern.h and compares every
+received frame with it.  It locks onto the stream from the data itself, then
+counts frames that match, all-zero frames (the device sends silence while muted,
+gated or starting), frames lost or repeated (from the jump in frame number at the
+next lock), and corrupt frames that match nothing.
+
+The counter pattern gives exact drop and repeat counts, modulo its 24 bit frame
+number.  The sweep repeats every TEST_PATTERN_SWEEP_FRAMES, so a jump is only
+known modulo that, and is counted as a drop if it is forward by up to half the
+period and as a repeat of the rest otherwise.  A sweep lock needs LOCK_FRAMES
+frames; process() stops short when fewer are left, and PatternReader keeps them
+for the next read.
+
+Silence while locked keeps the frame count, silence and corrupt frames while
+unlocked are counted as frames the stream moved on by.
+*/
+
+#ifndef _MICARRAY_PATTERN_VERIFIER_H_
+#define _MICARRAY_PATTERN_VERIFIER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "capture_source.h"
+#include "../test_pattern.h"
+
+namespace micarray {
+
+struct VerifyStats {
+    uint64_t frames = 0;
+    uint64_t matched = 0;
+    uint64_t silent = 0;
+    uint64_t dropped = 0;
+    uint64_t repeated = 0;
+    uint64_t corrupt = 0;
+    uint64_t locks = 0;
+};
+
+class PatternVerifier {
+public:
+    static const size_t LOCK_FRAMES = 8;            // frames that must agree before the sweep is trusted
+
+    PatternVerifier(int pattern, int channels) : pattern_(pattern), channels_(channels), expected_(channels) {
+        if (pattern_ == TEST_PATTERN_SWEEP) {
+            sweep_.resize(TEST_PATTERN_SWEEP_FRAMES);
+            for (uint32_t m = 0; m < TEST_PATTERN_SWEEP_FRAMES; m++) sweep_[m] = test_pattern_sweep_at(m);
+        }
+    }
+
+    // Check frames; returns how many were consumed.  Fewer than given means the
+    // verifier needs more frames to lock and the rest should be offered again.
+    size_t process(const int32_t* frames, size_t count, VerifyStats* stats) {
+        size_t i = 0;
+        while (i < count) {
+            const int32_t* f = frames + i * channels_;
+            if (locked_) {
+                test_pattern_fill(&gen_, expected_.data(), 1);
+                if (std::memcmp(f, expected_.data(), channels_ * sizeof(int32_t)) == 0) {
+                    stats->matched++;
+                } else if (all_zero(f)) {
+                    stats->silent++;                          // device replaced the block, timing is kept
+                } else {
+                    locked_ = false;
+                    expected_frame_ = gen_.frame - 1;       // number this frame should have had
+                    continue;                               // try to lock on it
+                }
+                stats->frames++;
+                i++;
+                continue;
+            }
+            if (all_zero(f)) {
+                stats->silent++;
+                stats->frames++;
+                if (have_lock_history_) expected_frame_++;
+                i++;
+                continue;
+            }
+            uint64_t frame_no;
+            int found = (pattern_ == TEST_PATTERN_COUNTER) ? lock_counter(f, &frame_no)
+                                                           : lock_sweep(f, count - i, &frame_no);
+            if (found < 0) return i;                        // not enough frames to decide yet
+            if (found == 0) {
+                stats->corrupt++;
+                stats->frames++;
+                if (have_lock_history_) expected_frame_++;
+                narrow_run_ = narrow(f) ? narrow_run_ + 1 : 0;
+                i++;
+                continue;
+            }
+            if (have_lock_history_) account_jump(frame_no, stats);
+            test_pattern_start(&gen_, pattern_, channels_, frame_no);
+            locked_ = true;
+            have_lock_history_ = true;
+            narrow_run_ = 0;
+            stats->locks++;
+        }
+        return i;
+    }
+
+    // True when the stream never locked and its last LOCK_FRAMES frames were counter
+    // words with the channel byte cleared: the samples were cut to 24 or 16 bits on
+    // the way, and the counter pattern cannot be checked.
+    bool channel_byte_missing() const {
+        return pattern_ == TEST_PATTERN_COUNTER && !have_lock_history_ && narrow_run_ >= LOCK_FRAMES;
+    }
+
+private:
+    bool all_zero(const int32_t* f) const {
+        for (int c = 0; c < channels_; c++) if (f[c] != 0) return false;
+        return true;
+    }
+
+    // the same word on every channel with bits 7-0 clear, a counter frame without its channel numbers
+    bool narrow(const int32_t* f) const {
+        if (channels_ < 2 || ((uint32_t)f[0] & 0xFF) != 0) return false;
+        for (int c = 1; c < channels_; c++) if (f[c] != f[0]) return false;
+        return true;
+    }
+
+    int lock_counter(const int32_t* f, uint64_t* frame_no) const {
+        uint32_t n = (uint32_t)f[0] >> 8;
+        for (int c = 0; c < channels_; c++) {
+            if (((uint32_t)f[c] & 0xFF) != (uint32_t)(c & 0xFF) || ((uint32_t)f[c] >> 8) != n) return 0;
+        }
+        *frame_no = n;
+        return 1;
+    }
+
+    // 1 with a unique sweep position, 0 if nothing fits, -1 if more frames are needed
+    int lock_sweep(const int32_t* f, size_t available, uint64_t* frame_no) const {
+        if (available < LOCK_FRAMES) return -1;
+        int hits = 0;
+        for (uint32_t m = 0; m < TEST_PATTERN_SWEEP_FRAMES && hits < 2; m++) {
+            bool ok = true;
+            for (size_t k = 0; k < LOCK_FRAMES && ok; k++) {
+                for (int c = 0; c < channels_ && ok; c++) {
+                    ok = f[k * channels_ + c] == sweep_[test_pattern_sweep_index(m + k, c)];
+                }
+            }
+            if (ok) {
+                *frame_no = m;
+                hits++;
+            }
+        }
+        return hits == 1 ? 1 : 0;
+    }
+
+    void account_jump(uint64_t frame_no, VerifyStats* stats) const {
+        if (pattern_ == TEST_PATTERN_COUNTER) {
+            int32_t jump = (int32_t)(((uint32_t)frame_no - (uint32_t)expected_frame_) << 8) >> 8;   // signed 24 bit
+            if (jump > 0) stats->dropped += (uint64_t)jump;
+            else stats->repeated += (uint64_t)(-jump);
+        } else {
+            uint64_t expected = expected_frame_ % TEST_PATTERN_SWEEP_FRAMES;
+            uint64_t jump = (frame_no + TEST_PATTERN_SWEEP_FRAMES - expected) % TEST_PATTERN_SWEEP_FRAMES;
+            if (jump <= TEST_PATTERN_SWEEP_FRAMES / 2) stats->dropped += jump;
+            else stats->repeated += TEST_PATTERN_SWEEP_FRAMES - jump;                // went back, the nearer reading
+        }
+    }
+
+    int pattern_;
+    int channels_;
+    bool locked_ = false;
+    bool have_lock_history_ = false;
+    uint64_t expected_frame_ = 0;
+    size_t narrow_run_ = 0;
+    struct test_pattern gen_;
+    std::vector<int32_t> expected_;
+    std::vector<int32_t> sweep_;
+};
+
+// Reads a source in chunks into a verifier, keeping the frames a lock attempt could
+// not use yet in front of the next read.
+class PatternReader {
+public:
+    PatternReader(int channels, size_t chunk)
+        : channels_(channels), chunk_(chunk), buf_((chunk + PatternVerifier::LOCK_FRAMES) * channels) {}
+
+    // one read of up to chunk frames; false at the end of the stream
+    bool read(CaptureSource* source, PatternVerifier* verifier, VerifyStats* stats) {
+        long n = source->read(buf_.data() + held_ * channels_, chunk_);
+        if (n <= 0) return false;
+        size_t total = held_ + (size_t)n;
+        size_t used = verifier->process(buf_.data(), total, stats);
+        held_ = total - used;
+        std::memmove(buf_.data(), buf_.data() + used * channels_, held_ * channels_ * sizeof(int32_t));
+        return true;
+    }
+
+    size_t held() const { return held_; }            // frames waiting for a lock, not yet counted
+
+private:
+    int channels_;
+    size_t chunk_;
+    size_t held_ = 0;
+    std::vector<int32_t> buf_;
+};
+
+}  // namespace micarray
+
+#endif
@@ -0,0 +1,97 @@
+/*
+Level and sensor monitor reading a MicArray capture ring.
+G. Whaley
+
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (C) 2025 The Whaley Group
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ *
+ */
+
+//  Usage:  ring_monitor FILE [--from-start]
+//  Prints per channel RMS level in dBFS once a second together with the latest
+//  temperature and mic spacing from the ring metadata.  Any number of monitors
+//  may run against one ring alongside recorders and beamformers.  Started before
+//  the capture, it waits for the ring to be created.
+
+#include "capture_ring.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+using namespace micarray;
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        std::fprintf(stderr, "usage: ring_monitor FILE [--from-start]\n");
+        return 2;
+    }
+    RingReader ring;
+    for (bool waiting = false; !ring.open(argv[1]); waiting = true) {
+        if (!waiting) std::fprintf(stderr, "waiting for ring %s\n", argv[1]);
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    }
+    bool from_start = argc > 2 && std::strcmp(argv[2], "--from-start") == 0;
+    if (from_start) ring.seek_oldest();
+
+    uint32_t ch = ring.channels();
+    std::vector<double> sum(ch, 0.0);
+    size_t counted = 0;
+    while (true) {
+        size_t n;
+        const int32_t* p = ring.view(4096, &n);
+        if (n == 0) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+            continue;
+        }
+        std::vector<double> part(ch, 0.0);
+        for (size_t i = 0; i < n; i++) {
+            for (uint32_t c = 0; c < ch; c++) {
+                double v = (p[i * ch + c] & (int32_t)0xFFFFFF00) / 2147483648.0;
+                part[c] += v * v;
+            }
+        }
+        if (!ring.release(n)) continue;                         // overwritten while we looked, discard
+        for (uint32_t c = 0; c < ch; c++) sum[c] += part[c];
+        counted += n;
+
+        if (counted >= ring.sample_rate()) {
+            std::printf("frame %10llu ", (unsigned long long)ring.cursor());
+            for (uint32_t c = 0; c < ch; c++) {
+                std::printf(" ch%u %6.1f dBFS", c, 10.0 * std::log10(sum[c] / counted + 1e-20));
+                sum[c] = 0.0;
+            }
+            RingMetadata meta;
+            if (ring.metadata(&meta)) {
+                std::printf("   %.2f C  %d mm", meta.temperature_centi_c / 100.0, meta.mic_distance_mm);
+            }
+            std::printf("   overruns %llu\n", (unsigned long long)ring.overruns());
+            std::fflush(stdout);
+            counted = 0;
+        }
+    }
+}
@@ -0,0 +1,593 @@
+/*
+Soak test of the firmware capture and USB code under simulated hardware timing.
+G. Whaley
+
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (C) 2025 The Whaley Group
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ *
+ */
+
+/*
+Usage:  capture_soak [options]
+    --hours H          simulated time (default 1)
+    --seed N           random seed (default 1)
+    --device-ppm P     error of the device sample clock (default 40)
+    --host-ppm P       error of the host USB frame clock (default -25)
+    --irq-jitter-us U  dma irq latency, uniform 0..U (default 5)
+    --irq-spike-us U   latency when the irq lands in a masked section (default 50)
+    --irq-spike-rate R such spikes per second (default 2)
+    --loop-us U        mean main loop pass while streaming (default 20)
+    --stall-rate R     USB service delays per second, e.g. a slow tud_task (default 5)
+    --stall-ms M       longest service delay, uniform 0..M (default 2)
+    --reopen-s S       mean seconds a stream stays open, 0 = open once (default 300)
+    --gap-s S          longest time the host leaves the stream closed, uniform 0..S (default 20)
+    --interval S       simulated seconds between progress lines, 0 = none (default 600)
+
+The firmware's own stereo_usb_mic.c, stereo_mic_i2s.c and usb_mic_callbacks.c run
+unmodified on soak_sim.c, which stands in for the PIO, dma and TinyUSB.  The main
+loop is stepped one capture_poll() at a time, the dma irq runs when its block
+completes plus a random latency, and the host takes one packet per USB frame from
+its own clock.  A gap of --gap-s longer than CAPTURE_IDLE_SLEEP_MS lets the mics go
+to sleep, so the restart path is exercised too.
+
+Every sample carries its sample clock tick (soak_sim.h), and the host side checks:
+    drops, repeats   jumps in the tick sequence within one open stream
+    corrupt          a frame whose two channels do not agree
+    silence          all-zero frames after valid audio in the same stream
+    ownership        a block handed to the USB fifo that is not the block the ring
+                     slot was filled with, or whose slot the dma may be refilling
+    overflows        PIO fifo full before the dma irq was served, or USB fifo full
+                     when a block was written
+    drift            frames per host millisecond against the two clock errors, to
+                     within the slope error the buffering wander allows, once that
+                     is under half the expected drift.  At the default clocks
+                     that needs streams open a minute on average and a run of at
+                     least 0.05 h (Soak::drift)
+
+The report gives the throughput, the latency from the dma irq of a block to the
+host receiving its last frame, and the high-water marks of the PIO fifo, the sample
+ring and the USB fifo.  The exit status is 0 only if every check passed; the result
+line names the checks that failed.  An unknown option or a value that is not a
+number prints the usage and exits with 2.
+*/
+
+#include "soak_sim.h"
+
+#include <algorithm>
+#include <cinttypes>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+extern "C" {
+extern volatile uint32_t blocks_captured;
+extern uint32_t blocks_sent;
+extern const uint32_t soak_ring_blocks;
+bool soak_capture_sleeping(void);
+void capture_init(void);
+void capture_poll(void);
+}
+
+namespace {
+
+constexpr int kFrameBytes = MIC_BYTES_PER_SAMPLE * MIC_CHANNELS;
+constexpr uint32_t kCounterMask = (1u << SOAK_COUNTER_BITS) - 1;
+constexpr uint64_t kLatencyBucketNs = 10000;
+constexpr size_t kLatencyBuckets = 10000;               // 100 ms
+constexpr size_t kBlockHistory = 4096;                  // power of 2, well beyond the ring
+
+struct Options {
+    double hours = 1;
+    uint64_t seed = 1;
+    double device_ppm = 40;
+    double host_ppm = -25;
+    double irq_jitter_us = 5;
+    double irq_spike_us = 50;
+    double irq_spike_rate = 2;
+    double loop_us = 20;
+    double stall_rate = 5;
+    double stall_ms = 2;
+    double reopen_s = 300;
+    double gap_s = 20;
+    double interval_s = 600;
+};
+
+void usage() {
+    std::fprintf(stderr,
+        "usage: capture_soak [--hours H] [--seed N] [--device-ppm P] [--host-ppm P]\n"
+        "                    [--irq-jitter-us U] [--irq-spike-us U] [--irq-spike-rate R]\n"
+        "                    [--loop-us U] [--stall-rate R] [--stall-ms M]\n"
+        "                    [--reopen-s S] [--gap-s S] [--interval S]\n");
+}
+
+// false, with the reason on stderr, for an unknown option or a value that is not a number
+bool parse_args(int argc, char** argv, Options& o) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        double* value = nullptr;
+        if (arg == "-h" || arg == "--help") return false;
+        else if (arg == "--hours") value = &o.hours;
+        else if (arg == "--device-ppm") value = &o.device_ppm;
+        else if (arg == "--host-ppm") value = &o.host_ppm;
+        else if (arg == "--irq-jitter-us") value = &o.irq_jitter_us;
+        else if (arg == "--irq-spike-us") value = &o.irq_spike_us;
+        else if (arg == "--irq-spike-rate") value = &o.irq_spike_rate;
+        else if (arg == "--loop-us") value = &o.loop_us;
+        else if (arg == "--stall-rate") value = &o.stall_rate;
+        else if (arg == "--stall-ms") value = &o.stall_ms;
+        else if (arg == "--reopen-s") value = &o.reopen_s;
+        else if (arg == "--gap-s") value = &o.gap_s;
+        else if (arg == "--interval") value = &o.interval_s;
+        else if (arg != "--seed") {
+            std::fprintf(stderr, "capture_soak: unknown option %s\n", arg.c_str());
+            return false;
+        }
+        if (i + 1 >= argc) {
+            std::fprintf(stderr, "capture_soak: %s needs a value\n", arg.c_str());
+            return false;
+        }
+        const char* text = argv[++i];
+        char* end = nullptr;
+        if (value) *value = std::strtod(text, &end);
+        else o.seed = std::strtoull(text, &end, 0);
+        if (end == text || *end != '\0') {
+            std::fprintf(stderr, "capture_soak: %s takes a number, not %s\n", arg.c_str(), text);
+            return false;
+        }
+    }
+    return o.hours > 0 && o.loop_us > 0;
+}
+
+// one sample as it is on the wire, top 24 bits
+uint32_t wire_sample24(const uint8_t* p) {
+#if MIC_BYTES_PER_SAMPLE == 4
+    return (uint32_t)(p[1] | (p[2] << 8) | (p[3] << 16));
+#else
+    return (uint32_t)(p[0] | (p[1] << 8) | (p[2] << 16));
+#endif
+}
+
+enum class Frame { Data, Silent, Corrupt };
+
+Frame decode_frame(const uint8_t* p, uint32_t& counter) {
+    uint32_t left = wire_sample24(p);
+    uint32_t right = wire_sample24(p + MIC_BYTES_PER_SAMPLE);
+    if (left == 0 && right == 0) return Frame::Silent;
+    if (right != (~left & kCounterMask)) return Frame::Corrupt;
+    counter = left;
+    return Frame::Data;
+}
+
+// the tick a counter value stands for, taking the newest one not after latest
+uint64_t counter_tick(uint32_t counter, uint64_t latest) {
+    uint64_t back = (latest - (uint64_t)counter + 1) & kCounterMask;
+    return latest - back;
+}
+
+struct Stats {
+    uint64_t frames = 0;
+    uint64_t data = 0;
+    uint64_t startup_silent = 0;
+    uint64_t silent = 0;                                // after valid audio, a failure
+    uint64_t dropped = 0;
+    uint64_t repeated = 0;
+    uint64_t corrupt = 0;
+    uint64_t ownership = 0;
+    uint64_t blocks_written = 0;
+    uint64_t blocks_skipped = 0;
+    uint32_t ring_high_water = 0;
+    uint64_t streams = 0;
+    uint64_t sleeps = 0;
+    uint64_t irqs = 0;
+    uint64_t host_ms_open = 0;
+
+    std::vector<uint64_t> latency = std::vector<uint64_t>(kLatencyBuckets + 1);
+    uint64_t latency_n = 0;
+    double latency_sum_ns = 0;
+    uint64_t latency_worst_ns = 0;
+
+    // least squares of tick, less the nominal MIC_FRAMES_PER_MS a frame, against host
+    // frame, pooled over streams: each stream has its own offset and they share the slope
+    double sxx = 0, sxy = 0, syy = 0;
+    uint64_t fit_points = 0, fit_streams = 0;
+};
+
+struct Drift {
+    double expected_ppm = 0;
+    double measured_ppm = 0;
+    double tolerance_ppm = 0;
+    bool resolved = false;                      // tolerance fine enough to tell the device clock from the host's
+};
+
+struct BlockRecord {
+    uint32_t block = 0;
+    uint64_t first_tick = 0;
+    bool valid = false;
+};
+
+class Soak {
+public:
+    explicit Soak(const Options& o) : o_(o), rng_(o.seed) {}
+
+    bool run();
+    void on_write(const void* data, uint16_t len);
+
+private:
+    double uniform(double hi) { return std::uniform_real_distribution<double>(0, hi)(rng_); }
+    double exponential(double mean) { return std::exponential_distribution<double>(1 / mean)(rng_); }
+
+    uint64_t irq_latency_ns();
+    void schedule_poll(uint64_t earliest);
+    void toggle_stream();
+    void on_packet(const uint8_t* p, int n);
+    void on_frame(const uint8_t* p);
+    void record_latency(uint64_t ns);
+    void close_segment();
+    Drift drift() const;
+    void report(bool final);
+
+    Options o_;
+    std::mt19937_64 rng_;
+    Stats s_;
+
+    uint64_t end_ns_ = 0;
+    uint64_t sof_index_ = 0;
+    double sof_period_ns_ = 1e6;
+    uint64_t t_sof_ = 0, t_poll_ = 0, t_irq_ = SOAK_NEVER, t_toggle_ = 0, t_stall_ = SOAK_NEVER;
+    uint64_t t_spike_ = SOAK_NEVER, t_report_ = SOAK_NEVER;
+    bool sleeping_ = false;                             // main loop waiting in best_effort_wfe_or_timeout()
+    bool mics_asleep_ = false;
+
+    uint64_t pending_first_ = 0, pending_last_ = 0;     // block completed, irq not yet served
+    uint64_t latest_tick_ = 0;
+    std::vector<BlockRecord> blocks_ = std::vector<BlockRecord>(kBlockHistory);
+    std::deque<std::pair<uint64_t, uint64_t>> irq_times_;   // last tick of a block, its irq time
+
+    bool open_ = false;
+    bool locked_ = false;
+    bool audio_seen_ = false;
+    uint64_t expected_tick_ = 0;
+    bool have_written_ = false;
+    uint32_t last_written_ = 0;
+    std::vector<uint8_t> carry_;
+
+    // regression sums of the open stream, relative to its first point
+    uint64_t seg_n_ = 0, seg_x0_ = 0, seg_y0_ = 0;
+    double seg_sx_ = 0, seg_sy_ = 0, seg_sxx_ = 0, seg_sxy_ = 0, seg_syy_ = 0;
+};
+
+Soak* soak_instance;
+
+void write_hook(const void* data, uint16_t len) {
+    soak_instance->on_write(data, len);
+}
+
+uint64_t Soak::irq_latency_ns() {
+    double us = uniform(o_.irq_jitter_us);
+    if (soak_now_ns >= t_spike_) {                     // this irq waits out a masked section
+        us += uniform(o_.irq_spike_us);
+        t_spike_ = soak_now_ns + (uint64_t)(exponential(1 / o_.irq_spike_rate) * 1e9);
+    }
+    return (uint64_t)(us * 1000) + 1;
+}
+
+// next main loop pass, pushed back if it runs into a service delay
+void Soak::schedule_poll(uint64_t earliest) {
+    t_poll_ = earliest;
+    while (t_poll_ >= t_stall_) {
+        t_poll_ = std::max(t_poll_, t_stall_ + (uint64_t)(uniform(o_.stall_ms) * 1e6));
+        t_stall_ += (uint64_t)(exponential(1 / o_.stall_rate) * 1e9);
+    }
+}
+
+void Soak::toggle_stream() {
+    if (open_) {
+        close_segment();
+        open_ = false;
+        soak_usb_set_alt(0);
+        double gap = uniform(o_.gap_s);
+        t_toggle_ = soak_now_ns + (uint64_t)(gap * 1e9) + 1;
+    } else {
+        open_ = true;
+        locked_ = false;
+        audio_seen_ = false;
+        have_written_ = false;
+        carry_.clear();
+        s_.streams++;
+        soak_usb_set_alt(1);
+        t_toggle_ = o_.reopen_s > 0 ? soak_now_ns + (uint64_t)(exponential(o_.reopen_s) * 1e9) + 1 : SOAK_NEVER;
+    }
+}
+
+// A block committed to the USB fifo, always block blocks_sent.  It must still be
+// in its ring slot (the dma irq refills slot n % ring with block n + ring) and hold
+// the frames the dma captured for it.
+void Soak::on_write(const void* data, uint16_t len) {
+    uint32_t n = blocks_sent;
+    s_.blocks_written++;
+    if (have_written_ && n - last_written_ != 1) s_.blocks_skipped += n - last_written_ - 1;
+    have_written_ = true;
+    last_written_ = n;
+
+    uint32_t counter = 0;
+    if (len < kFrameBytes) return;
+    Frame f = decode_frame(static_cast<const uint8_t*>(data), counter);
+    if (f == Frame::Silent) return;                    // start-up or gated, not from the ring
+    if (blocks_captured - n >= soak_ring_blocks) s_.ownership++;
+    const BlockRecord& r = blocks_[n & (kBlockHistory - 1)];
+    if (f == Frame::Data) {
+        if (!r.valid || r.block != n || ((r.first_tick + 1) & kCounterMask) != counter) s_.ownership++;
+    }
+}
+
+void Soak::record_latency(uint64_t ns) {
+    s_.latency[std::min<uint64_t>(ns / kLatencyBucketNs, kLatencyBuckets)]++;
+    s_.latency_n++;
+    s_.latency_sum_ns += (double)ns;
+    s_.latency_worst_ns = std::max(s_.latency_worst_ns, ns);
+}
+
+void Soak::on_frame(const uint8_t* p) {
+    s_.frames++;
+    uint32_t counter = 0;
+    switch (decode_frame(p, counter)) {
+    case Frame::Silent:
+        if (audio_seen_) s_.silent++;
+        else s_.startup_silent++;
+        if (locked_) expected_tick_++;
+        return;
+    case Frame::Corrupt:
+        s_.corrupt++;
+        if (locked_) expected_tick_++;
+        return;
+    case Frame::Data:
+        break;
+    }
+    uint64_t tick = counter_tick(counter, latest_tick_);
+    s_.data++;
+    audio_seen_ = true;
+    if (locked_) {
+        if (tick > expected_tick_) s_.dropped += tick - expected_tick_;
+        if (tick < expected_tick_) s_.repeated += expected_tick_ - tick;
+    }
+    locked_ = true;
+    expected_tick_ = tick + 1;
+
+    while (!irq_times_.empty() && irq_times_.front().first < tick) irq_times_.pop_front();
+    if (!irq_times_.empty() && irq_times_.front().first == tick) {
+        record_latency(soak_now_ns - irq_times_.front().second);
+        irq_times_.pop_front();
+    }
+}
+
+void Soak::on_packet(const uint8_t* p, int n) {
+    carry_.insert(carry_.end(), p, p + n);
+    size_t whole = carry_.size() / kFrameBytes * kFrameBytes;
+    for (size_t i = 0; i < whole; i += kFrameBytes) on_frame(&carry_[i]);
+    carry_.erase(carry_.begin(), carry_.begin() + whole);
+
+    if (locked_ && n > 0) {                            // newest tick against host time for the drift fit
+        if (seg_n_ == 0) {
+            seg_x0_ = sof_index_;
+            seg_y0_ = expected_tick_;
+        }
+        // ticks ahead of the nominal rate, which keeps the sums small enough that SSR
+        // does not cancel away in doubles over a long stream
+        uint64_t dx = sof_index_ - seg_x0_;
+        double x = (double)dx, y = (double)(int64_t)(expected_tick_ - seg_y0_ - dx * MIC_FRAMES_PER_MS);
+        seg_n_++;
+        seg_sx_ += x; seg_sy_ += y; seg_sxx_ += x * x; seg_sxy_ += x * y; seg_syy_ += y * y;
+    }
+}
+
+void Soak::close_segment() {
+    if (seg_n_ > 1) {
+        s_.sxx += seg_sxx_ - seg_sx_ * seg_sx_ / seg_n_;
+        s_.sxy += seg_sxy_ - seg_sx_ * seg_sy_ / seg_n_;
+        s_.syy += seg_syy_ - seg_sy_ * seg_sy_ / seg_n_;
+        s_.fit_points += seg_n_;
+        s_.fit_streams++;
+    }
+    seg_n_ = 0;
+    seg_sx_ = seg_sy_ = seg_sxx_ = seg_sxy_ = seg_syy_ = 0;
+}
+
+// The slope of the pooled fit against the rate the two clock errors give.  The
+// residuals are the buffering between the sample clock and the host (ring backlog,
+// fifos, packet sizes), which wanders slowly rather than being independent per
+// point, so the standard error of the fit understates the slope error many times.
+// The tolerance is instead the slope change the whole residual could make if it
+// lay along the fit, sqrt(SSR / Sxx) by Cauchy-Schwarz; it shrinks as the streams
+// get longer, to about 2 ppm for the default hour.
+//
+// The check is there to show the stream follows the device clock and not the
+// host's, which would read 0 ppm, so it only counts once the tolerance is under
+// half the expected drift.  The tolerance falls with the length of each stream more
+// than with the run: with the default clocks (65 ppm apart) the streams need to stay
+// open for about a minute on average (--reopen-s 60) and the run to last at least
+// 0.05 h.  A shorter run fails the drift check as unresolved.
+Drift Soak::drift() const {
+    Drift d;
+    d.expected_ppm = ((1 + o_.device_ppm * 1e-6) / (1 + o_.host_ppm * 1e-6) - 1) * 1e6;
+    if (s_.sxx > 0) {
+        double ssr = std::max(s_.syy - s_.sxy * s_.sxy / s_.sxx, 0.0);
+        d.measured_ppm = s_.sxy / s_.sxx / MIC_FRAMES_PER_MS * 1e6;
+        d.tolerance_ppm = std::sqrt(ssr / s_.sxx) / MIC_FRAMES_PER_MS * 1e6;
+        d.resolved = d.tolerance_ppm < std::fabs(d.expected_ppm) / 2;
+    }
+    return d;
+}
+
+void Soak::report(bool final) {
+    double seconds = soak_now_ns / 1e9;
+    double mean_ms = s_.latency_n ? s_.latency_sum_ns / s_.latency_n / 1e6 : 0;
+    if (!final) {
+        std::printf("%8.0f s  frames %" PRIu64 "  dropped %" PRIu64 "  repeated %" PRIu64 "  corrupt %" PRIu64
+                    "  ownership %" PRIu64 "  latency %.2f/%.2f ms  usb fifo %u B\n",
+                    seconds, s_.frames, s_.dropped, s_.repeated, s_.corrupt, s_.ownership,
+                    mean_ms, s_.latency_worst_ns / 1e6, soak_counters.usb_fifo_high_water);
+        std::fflush(stdout);
+        return;
+    }
+
+    double p99_ms = 0, p999_ms = 0;
+    uint64_t seen = 0;
+    for (size_t i = 0; i <= kLatencyBuckets; i++) {
+        seen += s_.latency[i];
+        double ms = (i + 1) * kLatencyBucketNs / 1e6;
+        if (p99_ms == 0 && seen >= s_.latency_n * 0.99) p99_ms = ms;
+        if (p999_ms == 0 && seen >= s_.latency_n * 0.999) p999_ms = ms;
+    }
+    double host_s = s_.host_ms_open / 1000.0;
+    Drift d = drift();
+
+    std::printf("\nsimulated        %.1f s, streams opened %" PRIu64 ", mic sleeps %" PRIu64 ", dma irqs %" PRIu64 "\n",
+                seconds, s_.streams, s_.sleeps, s_.irqs);
+    std::printf("throughput       %.1f frames/s, %.1f kB/s over %.1f s streaming (host clock)\n",
+                host_s > 0 ? s_.frames / host_s : 0, host_s > 0 ? s_.frames * kFrameBytes / host_s / 1000 : 0, host_s);
+    std::printf("drift            expected %+.3f ppm, measured %+.3f ppm, tolerance %.3f ppm over %" PRIu64 " streams\n",
+                d.expected_ppm, d.measured_ppm, d.tolerance_ppm, s_.fit_streams);
+    if (!d.resolved) {
+        std::printf("                 unresolved, the tolerance must be under %.3f ppm: open the streams for longer\n",
+                    std::fabs(d.expected_ppm) / 2);
+    }
+    std::printf("frames           %" PRIu64 " received, %" PRIu64 " audio, %" PRIu64 " start-up silence\n",
+                s_.frames, s_.data, s_.startup_silent);
+    std::printf("errors           %" PRIu64 " dropped, %" PRIu64 " repeated, %" PRIu64 " corrupt, %" PRIu64
+                " silent after audio\n", s_.dropped, s_.repeated, s_.corrupt, s_.silent);
+    std::printf("ownership        %" PRIu64 " violations, %" PRIu64 " blocks written, %" PRIu64 " skipped\n",
+                s_.ownership, s_.blocks_written, s_.blocks_skipped);
+    std::printf("irq to usb       mean %.3f ms, p99 %.2f ms, p99.9 %.2f ms, worst %.3f ms\n",
+                mean_ms, p99_ms, p999_ms, s_.latency_worst_ns / 1e6);
+    std::printf("pio fifo         high water %u of %d frames, %" PRIu64 " overflows, %" PRIu64 " frames lost\n",
+                soak_counters.pio_fifo_high_water, SOAK_PIO_FIFO_FRAMES, soak_counters.pio_overflows,
+                soak_counters.pio_frames_lost);
+    std::printf("sample ring      backlog high water %u blocks, the ring holds %u\n", s_.ring_high_water, soak_ring_blocks);
+    std::printf("usb fifo         high water %u of %d bytes, %" PRIu64 " bytes dropped, %" PRIu64
+                " host polls with no packet armed\n", soak_counters.usb_fifo_high_water, SOAK_USB_FIFO_BYTES,
+                soak_counters.usb_bytes_dropped, soak_counters.usb_polls_missed);
+}
+
+bool Soak::run() {
+    soak_instance = this;
+    soak_usb_write_hook = write_hook;
+    soak_frame_ns = 1e9 / (MIC_SAMPLE_RATE * (1 + o_.device_ppm * 1e-6));
+    sof_period_ns_ = 1e6 / (1 + o_.host_ppm * 1e-6);
+    end_ns_ = (uint64_t)(o_.hours * 3600e9);
+    t_sof_ = (uint64_t)sof_period_ns_;
+    t_toggle_ = 500000000;                              // host opens the stream after enumeration
+    if (o_.stall_rate > 0) t_stall_ = (uint64_t)(exponential(1 / o_.stall_rate) * 1e9);
+    if (o_.irq_spike_rate > 0) t_spike_ = (uint64_t)(exponential(1 / o_.irq_spike_rate) * 1e9);
+    if (o_.interval_s > 0) t_report_ = (uint64_t)(o_.interval_s * 1e9);
+
+    soak_now_ns = 0;
+    capture_init();
+    schedule_poll(0);
+
+    while (soak_now_ns < end_ns_) {
+        uint64_t t_complete = soak_capture_completion_ns();
+        uint64_t t = std::min({ t_complete, t_irq_, t_sof_, t_poll_, t_toggle_, t_report_ });
+        soak_now_ns = t;
+
+        if (t == t_complete) {
+            soak_capture_complete(&pending_first_, &pending_last_);
+            latest_tick_ = pending_last_;
+            t_irq_ = t + irq_latency_ns();
+        } else if (t == t_irq_) {
+            t_irq_ = SOAK_NEVER;
+            uint32_t n = blocks_captured;
+            if (soak_capture_irq_pending()) {
+                soak_capture_irq();
+                s_.irqs++;
+                blocks_[n & (kBlockHistory - 1)] = BlockRecord{ n, pending_first_, true };
+                irq_times_.emplace_back(pending_last_, t);
+                if (irq_times_.size() > 4 * soak_ring_blocks) irq_times_.pop_front();
+                if (sleeping_) schedule_poll(std::min(t_poll_, t + 1000));     // the irq wakes the cpu from wfe
+            }
+        } else if (t == t_sof_) {
+            uint8_t packet[CFG_TUD_AUDIO_EP_SZ_IN];
+            int n = soak_usb_sof(packet);
+            if (open_) s_.host_ms_open++;
+            if (n >= 0) on_packet(packet, n);
+            sof_index_++;
+            t_sof_ = (uint64_t)((sof_index_ + 1) * sof_period_ns_);
+        } else if (t == t_toggle_) {
+            toggle_stream();
+            if (sleeping_) schedule_poll(std::min(t_poll_, t + 1000));
+        } else if (t == t_report_) {
+            report(false);
+            t_report_ += (uint64_t)(o_.interval_s * 1e9);
+        } else {
+            if (open_) s_.ring_high_water = std::max(s_.ring_high_water, blocks_captured - blocks_sent);
+            capture_poll();
+            if (soak_capture_sleeping() && !mics_asleep_) s_.sleeps++;
+            mics_asleep_ = soak_capture_sleeping();
+            uint64_t wake = soak_wfe_until_ns();
+            sleeping_ = (wake != 0);
+            uint64_t pass = (uint64_t)(o_.loop_us * (0.5 + uniform(1.0)) * 1000) + 1;
+            schedule_poll(sleeping_ ? std::max(wake, t + pass) : t + pass);
+        }
+    }
+    close_segment();
+    report(true);
+
+    Drift d = drift();
+    const std::pair<const char*, bool> checks[] = {
+        { "audio", s_.data > 0 },
+        { "drops", s_.dropped == 0 },
+        { "repeats", s_.repeated == 0 },
+        { "corrupt", s_.corrupt == 0 },
+        { "silence", s_.silent == 0 },
+        { "ownership", s_.ownership == 0 },
+        { "pio overflow", soak_counters.pio_overflows == 0 },
+        { "usb overflow", soak_counters.usb_bytes_dropped == 0 },
+        { "drift", d.resolved && std::fabs(d.measured_ppm - d.expected_ppm) <= d.tolerance_ppm },
+    };
+    std::string failed;
+    for (const auto& c : checks) {
+        if (!c.second) failed += failed.empty() ? c.first : std::string(", ") + c.first;
+    }
+    bool ok = failed.empty();
+    if (ok) std::printf("result           PASS\n");
+    else std::printf("result           FAIL: %s\n", failed.c_str());
+    return ok;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Options o;
+    if (!parse_args(argc, argv, o)) {
+        usage();
+        return 2;
+    }
+    Soak soak(o);
+    return soak.run() ? 0 : 1;
+}
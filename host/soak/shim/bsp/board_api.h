@@ -0,0 +1,9 @@
+#ifndef _SOAK_BSP_BOARD_API_H_
+#define _SOAK_BSP_BOARD_API_H_
+
+#include "pico/stdlib.h"
+
+void board_init(void);
+void board_led_write(bool state);
+
+#endif
@@ -0,0 +1,6 @@
+#ifndef _SOAK_HARDWARE_CLOCKS_H_
+#define _SOAK_HARDWARE_CLOCKS_H_
+
+#include "pico/stdlib.h"                    // the sample clock is simulated, see soak_sim.h
+
+#endif
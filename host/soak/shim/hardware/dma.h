@@ -0,0 +1,54 @@
+#ifndef _SOAK_HARDWARE_DMA_H_
+#define _SOAK_HARDWARE_DMA_H_
+
+#include "pico/stdlib.h"
+
+enum dma_channel_transfer_size { DMA_SIZE_8 = 0, DMA_SIZE_16 = 1, DMA_SIZE_32 = 2 };
+
+typedef struct {
+    uint32_t ctrl;
+} dma_channel_config;
+
+typedef struct {
+    volatile uint32_t transfer_count;       // words left in the transfer, kept up to date by the simulation
+} dma_channel_hw_t;
+
+typedef struct {
+    volatile uint32_t ints0;
+} dma_hw_t;
+
+extern dma_hw_t soak_dma_hw;
+#define dma_hw (&soak_dma_hw)
+
+dma_channel_hw_t* dma_channel_hw_addr(uint channel);
+int dma_claim_unused_channel(bool required);
+void dma_channel_configure(uint channel, const dma_channel_config* config, volatile void* write_addr,
+                           const volatile void* read_addr, uint transfer_count, bool trigger);
+void dma_channel_set_irq0_enabled(uint channel, bool enabled);
+void dma_channel_transfer_to_buffer_now(uint channel, volatile void* write_addr, uint32_t transfer_count);
+void dma_channel_start(uint channel);
+void dma_channel_abort(uint channel);
+
+static inline dma_channel_config dma_channel_get_default_config(uint channel) {
+    (void) channel;
+    dma_channel_config c = { 0 };
+    return c;
+}
+
+static inline void channel_config_set_transfer_data_size(dma_channel_config* c, enum dma_channel_transfer_size size) {
+    (void) c; (void) size;
+}
+
+static inline void channel_config_set_read_increment(dma_channel_config* c, bool incr) {
+    (void) c; (void) incr;
+}
+
+static inline void channel_config_set_write_increment(dma_channel_config* c, bool incr) {
+    (void) c; (void) incr;
+}
+
+static inline void channel_config_set_dreq(dma_channel_config* c, uint dreq) {
+    (void) c; (void) dreq;
+}
+
+#endif
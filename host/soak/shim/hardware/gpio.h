@@ -0,0 +1,18 @@
+#ifndef _SOAK_HARDWARE_GPIO_H_
+#define _SOAK_HARDWARE_GPIO_H_
+
+#include "pico/stdlib.h"
+
+#define GPIO_IN false
+#define GPIO_IRQ_EDGE_FALL 0x4u
+#define GPIO_IRQ_EDGE_RISE 0x8u
+
+typedef void (*gpio_irq_callback_t)(uint gpio, uint32_t event_mask);
+
+void gpio_init(uint gpio);
+void gpio_set_dir(uint gpio, bool out);
+void gpio_pull_down(uint gpio);
+bool gpio_get(uint gpio);
+void gpio_set_irq_enabled_with_callback(uint gpio, uint32_t event_mask, bool enabled, gpio_irq_callback_t callback);
+
+#endif
@@ -0,0 +1,185 @@
+#ifndef _SOAK_HARDWARE_INTERP_H_
+#define _SOAK_HARDWARE_INTERP_H_
+
+// A model of the RP2040 interpolator behind the SDK accessors, so the _interp
+// kernels can be checked bit for bit against the _c ones on the host.  Each lane
+// shifts its accumulator right (logical), keeps bits MASK_LSB to MASK_MSB and sign
+// extends from MASK_MSB when SIGNED; the lane result adds BASEn, PEEK_FULL adds
+// both masked lanes to BASE2, and interp1 lane0 with CLAMP returns the masked value
+// clamped to [BASE0, BASE1].  CROSS_INPUT, CROSS_RESULT, ADD_RAW and FORCE_MSB
+// follow the datasheet; BLEND is not modelled.  The registers are only read and
+// written through the accessors, so code that writes accum[] or reads peek[]
+// directly sees plain memory.  The soak calls the _c kernels.
+
+#include "pico/stdlib.h"
+
+typedef struct {
+    volatile uint32_t accum[2];
+    volatile uint32_t base[3];
+    volatile uint32_t pop[3];
+    volatile uint32_t peek[3];
+    volatile uint32_t ctrl[2];
+} interp_hw_t;
+
+typedef struct {
+    uint32_t accum[2];
+    uint32_t base[3];
+    uint32_t ctrl[2];
+} interp_hw_save_t;
+
+typedef struct {
+    uint32_t ctrl;
+} interp_config;
+
+#define INTERP_CTRL_SHIFT_LSB 0
+#define INTERP_CTRL_SHIFT_BITS 0x0000001Fu
+#define INTERP_CTRL_MASK_LSB_LSB 5
+#define INTERP_CTRL_MASK_LSB_BITS 0x000003E0u
+#define INTERP_CTRL_MASK_MSB_LSB 10
+#define INTERP_CTRL_MASK_MSB_BITS 0x00007C00u
+#define INTERP_CTRL_SIGNED_BITS 0x00008000u
+#define INTERP_CTRL_CROSS_INPUT_BITS 0x00010000u
+#define INTERP_CTRL_CROSS_RESULT_BITS 0x00020000u
+#define INTERP_CTRL_ADD_RAW_BITS 0x00040000u
+#define INTERP_CTRL_FORCE_MSB_LSB 19
+#define INTERP_CTRL_FORCE_MSB_BITS 0x00180000u
+#define INTERP_CTRL_CLAMP_BITS 0x00400000u     // lane0 of interp1 only
+
+extern interp_hw_t soak_interp0, soak_interp1;
+#define interp0 (&soak_interp0)
+#define interp1 (&soak_interp1)
+
+static inline interp_config interp_default_config(void) {
+    interp_config c = { 31u << INTERP_CTRL_MASK_MSB_LSB };    // no shift, all 32 bits, unsigned
+    return c;
+}
+
+static inline void interp_config_set_shift(interp_config* c, uint shift) {
+    c->ctrl = (c->ctrl & ~INTERP_CTRL_SHIFT_BITS) | ((shift << INTERP_CTRL_SHIFT_LSB) & INTERP_CTRL_SHIFT_BITS);
+}
+
+static inline void interp_config_set_mask(interp_config* c, uint lsb, uint msb) {
+    c->ctrl = (c->ctrl & ~(INTERP_CTRL_MASK_LSB_BITS | INTERP_CTRL_MASK_MSB_BITS)) |
+              ((lsb << INTERP_CTRL_MASK_LSB_LSB) & INTERP_CTRL_MASK_LSB_BITS) |
+              ((msb << INTERP_CTRL_MASK_MSB_LSB) & INTERP_CTRL_MASK_MSB_BITS);
+}
+
+static inline void interp_config_set_signed(interp_config* c, bool is_signed) {
+    c->ctrl = (c->ctrl & ~INTERP_CTRL_SIGNED_BITS) | (is_signed ? INTERP_CTRL_SIGNED_BITS : 0);
+}
+
+static inline void interp_config_set_cross_input(interp_config* c, bool cross_input) {
+    c->ctrl = (c->ctrl & ~INTERP_CTRL_CROSS_INPUT_BITS) | (cross_input ? INTERP_CTRL_CROSS_INPUT_BITS : 0);
+}
+
+static inline void interp_config_set_cross_result(interp_config* c, bool cross_result) {
+    c->ctrl = (c->ctrl & ~INTERP_CTRL_CROSS_RESULT_BITS) | (cross_result ? INTERP_CTRL_CROSS_RESULT_BITS : 0);
+}
+
+static inline void interp_config_set_add_raw(interp_config* c, bool add_raw) {
+    c->ctrl = (c->ctrl & ~INTERP_CTRL_ADD_RAW_BITS) | (add_raw ? INTERP_CTRL_ADD_RAW_BITS : 0);
+}
+
+static inline void interp_config_set_force_bits(interp_config* c, uint bits) {
+    c->ctrl = (c->ctrl & ~INTERP_CTRL_FORCE_MSB_BITS) | ((bits << INTERP_CTRL_FORCE_MSB_LSB) & INTERP_CTRL_FORCE_MSB_BITS);
+}
+
+static inline void interp_config_set_clamp(interp_config* c, bool clamp) {
+    c->ctrl = (c->ctrl & ~INTERP_CTRL_CLAMP_BITS) | (clamp ? INTERP_CTRL_CLAMP_BITS : 0);
+}
+
+static inline void interp_set_config(interp_hw_t* interp, uint lane, interp_config* config) {
+    interp->ctrl[lane] = config->ctrl;
+}
+
+static inline void interp_set_base(interp_hw_t* interp, uint lane, uint32_t val) {
+    interp->base[lane] = val;
+}
+
+static inline uint32_t interp_get_base(interp_hw_t* interp, uint lane) {
+    return interp->base[lane];
+}
+
+static inline void interp_set_accumulator(interp_hw_t* interp, uint lane, uint32_t val) {
+    interp->accum[lane] = val;
+}
+
+static inline uint32_t interp_get_accumulator(interp_hw_t* interp, uint lane) {
+    return interp->accum[lane];
+}
+
+// the shift, mask and sign extension of one lane
+static inline uint32_t soak_interp_masked(interp_hw_t* interp, uint lane) {
+    uint32_t ctrl = interp->ctrl[lane];
+    uint32_t in = interp->accum[(ctrl & INTERP_CTRL_CROSS_INPUT_BITS) ? 1 - lane : lane];
+    uint shift = (ctrl & INTERP_CTRL_SHIFT_BITS) >> INTERP_CTRL_SHIFT_LSB;
+    uint lsb = (ctrl & INTERP_CTRL_MASK_LSB_BITS) >> INTERP_CTRL_MASK_LSB_LSB;
+    uint msb = (ctrl & INTERP_CTRL_MASK_MSB_BITS) >> INTERP_CTRL_MASK_MSB_LSB;
+    uint32_t mask = (0xFFFFFFFFu >> (31 - msb)) & (0xFFFFFFFFu << lsb);
+    uint32_t v = (in >> shift) & mask;
+    if ((ctrl & INTERP_CTRL_SIGNED_BITS) && msb < 31 && (v & (1u << msb))) v |= 0xFFFFFFFFu << (msb + 1);
+    return v;
+}
+
+static inline uint32_t soak_interp_lane(interp_hw_t* interp, uint lane) {
+    uint32_t ctrl = interp->ctrl[lane];
+    uint32_t masked = soak_interp_masked(interp, lane);
+    uint32_t result;
+    if (lane == 0 && interp == interp1 && (ctrl & INTERP_CTRL_CLAMP_BITS)) {
+        if (ctrl & INTERP_CTRL_SIGNED_BITS) {
+            int32_t v = (int32_t)masked, lo = (int32_t)interp->base[0], hi = (int32_t)interp->base[1];
+            result = (uint32_t)(v < lo ? lo : v > hi ? hi : v);
+        } else {
+            result = masked < interp->base[0] ? interp->base[0] : masked > interp->base[1] ? interp->base[1] : masked;
+        }
+    } else {
+        uint32_t in = interp->accum[(ctrl & INTERP_CTRL_CROSS_INPUT_BITS) ? 1 - lane : lane];
+        result = interp->base[lane] + ((ctrl & INTERP_CTRL_ADD_RAW_BITS) ? in : masked);
+    }
+    return result | (((ctrl & INTERP_CTRL_FORCE_MSB_BITS) >> INTERP_CTRL_FORCE_MSB_LSB) << 28);
+}
+
+static inline uint32_t interp_peek_lane_result(interp_hw_t* interp, uint lane) {
+    return soak_interp_lane(interp, lane);
+}
+
+static inline uint32_t interp_peek_full_result(interp_hw_t* interp) {
+    return interp->base[2] + soak_interp_masked(interp, 0) + soak_interp_masked(interp, 1);
+}
+
+// a pop writes each lane result back to its accumulator, or the other one with CROSS_RESULT
+static inline void soak_interp_writeback(interp_hw_t* interp) {
+    uint32_t r0 = soak_interp_lane(interp, 0), r1 = soak_interp_lane(interp, 1);
+    interp->accum[0] = (interp->ctrl[0] & INTERP_CTRL_CROSS_RESULT_BITS) ? r1 : r0;
+    interp->accum[1] = (interp->ctrl[1] & INTERP_CTRL_CROSS_RESULT_BITS) ? r0 : r1;
+}
+
+static inline uint32_t interp_pop_lane_result(interp_hw_t* interp, uint lane) {
+    uint32_t r = soak_interp_lane(interp, lane);
+    soak_interp_writeback(interp);
+    return r;
+}
+
+static inline uint32_t interp_pop_full_result(interp_hw_t* interp) {
+    uint32_t r = interp_peek_full_result(interp);
+    soak_interp_writeback(interp);
+    return r;
+}
+
+static inline void interp_save(interp_hw_t* interp, interp_hw_save_t* saver) {
+    for (int i = 0; i < 2; i++) {
+        saver->accum[i] = interp->accum[i];
+        saver->ctrl[i] = interp->ctrl[i];
+    }
+    for (int i = 0; i < 3; i++) saver->base[i] = interp->base[i];
+}
+
+static inline void interp_restore(interp_hw_t* interp, interp_hw_save_t* saver) {
+    for (int i = 0; i < 2; i++) {
+        interp->accum[i] = saver->accum[i];
+        interp->ctrl[i] = saver->ctrl[i];
+    }
+    for (int i = 0; i < 3; i++) interp->base[i] = saver->base[i];
+}
+
+#endif
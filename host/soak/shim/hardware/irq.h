@@ -0,0 +1,13 @@
+#ifndef _SOAK_HARDWARE_IRQ_H_
+#define _SOAK_HARDWARE_IRQ_H_
+
+#include "pico/stdlib.h"
+
+#define DMA_IRQ_0 11
+
+typedef void (*irq_handler_t)(void);
+
+void irq_set_exclusive_handler(uint num, irq_handler_t handler);
+void irq_set_enabled(uint num, bool enabled);
+
+#endif
@@ -0,0 +1,37 @@
+#ifndef _SOAK_HARDWARE_PIO_H_
+#define _SOAK_HARDWARE_PIO_H_
+
+#include "pico/stdlib.h"
+
+typedef struct {
+    volatile uint32_t rxf[4];               // only its address is used, as the dma read address
+} pio_hw_t;
+
+typedef pio_hw_t* PIO;
+
+typedef struct {
+    const uint16_t* instructions;
+    uint8_t length;
+    int8_t origin;
+} pio_program_t;
+
+extern pio_hw_t soak_pio0;
+#define pio0 (&soak_pio0)
+
+uint pio_add_program(PIO pio, const pio_program_t* program);
+void pio_sm_clear_fifos(PIO pio, uint sm);
+void pio_sm_restart(PIO pio, uint sm);
+void pio_sm_exec(PIO pio, uint sm, uint instr);
+void pio_sm_set_enabled(PIO pio, uint sm, bool enabled);
+void pio_sm_set_pins_with_mask(PIO pio, uint sm, uint32_t values, uint32_t mask);
+
+static inline uint pio_encode_jmp(uint addr) {
+    return addr;
+}
+
+static inline uint pio_get_dreq(PIO pio, uint sm, bool is_tx) {
+    (void) pio; (void) is_tx;
+    return sm;
+}
+
+#endif
@@ -0,0 +1,15 @@
+#ifndef _SOAK_HARDWARE_STRUCTS_SYSTICK_H_
+#define _SOAK_HARDWARE_STRUCTS_SYSTICK_H_
+
+#include "pico/stdlib.h"
+
+typedef struct {
+    volatile uint32_t csr;
+    volatile uint32_t rvr;
+    volatile uint32_t cvr;
+} systick_hw_t;
+
+extern systick_hw_t soak_systick;
+#define systick_hw (&soak_systick)
+
+#endif
@@ -0,0 +1,11 @@
+#ifndef _SOAK_HARDWARE_SYNC_H_
+#define _SOAK_HARDWARE_SYNC_H_
+
+#include "pico/stdlib.h"
+
+#define __compiler_memory_barrier() __asm__ volatile ("" : : : "memory")
+
+uint32_t save_and_disable_interrupts(void);
+void restore_interrupts(uint32_t status);
+
+#endif
@@ -0,0 +1,8 @@
+#ifndef _SOAK_PICO_MULTICORE_H_
+#define _SOAK_PICO_MULTICORE_H_
+
+#include "pico/stdlib.h"
+
+void multicore_launch_core1(void (*entry)(void));      // not run, the spectrum is off in the soak
+
+#endif
@@ -0,0 +1,25 @@
+// Host stand-ins for the Pico SDK and TinyUSB headers the capture code includes.
+// Only what stereo_usb_mic.c and its modules use is declared; the behaviour is
+// simulated in soak_sim.c.
+#ifndef _SOAK_PICO_STDLIB_H_
+#define _SOAK_PICO_STDLIB_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+typedef unsigned int uint;
+typedef uint64_t absolute_time_t;           // microseconds of simulated time
+
+absolute_time_t get_absolute_time(void);
+absolute_time_t make_timeout_time_ms(uint32_t ms);
+bool best_effort_wfe_or_timeout(absolute_time_t timeout);
+void sleep_us(uint64_t us);
+bool stdio_init_all(void);
+
+static inline uint32_t to_ms_since_boot(absolute_time_t t) {
+    return (uint32_t)(t / 1000);
+}
+
+#endif
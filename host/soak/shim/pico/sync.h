@@ -0,0 +1,17 @@
+#ifndef _SOAK_PICO_SYNC_H_
+#define _SOAK_PICO_SYNC_H_
+
+// One thread on the host, so a critical section only has to exist.
+
+#include "pico/stdlib.h"
+#include "hardware/sync.h"
+
+typedef struct {
+    int locked;
+} critical_section_t;
+
+static inline void critical_section_init(critical_section_t* crit_sec) { crit_sec->locked = 0; }
+static inline void critical_section_enter_blocking(critical_section_t* crit_sec) { crit_sec->locked = 1; }
+static inline void critical_section_exit(critical_section_t* crit_sec) { crit_sec->locked = 0; }
+
+#endif
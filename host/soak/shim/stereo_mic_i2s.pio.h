@@ -0,0 +1,12 @@
+#ifndef _SOAK_STEREO_MIC_I2S_PIO_H_
+#define _SOAK_STEREO_MIC_I2S_PIO_H_
+
+// stands in for the header pioasm generates from stereo_mic_i2s.pio
+
+#include "hardware/pio.h"
+
+static const pio_program_t i2s_mic_program = { 0 };
+
+void i2s_mic_program_init(PIO pio, uint sm, uint offset, uint data_pin, uint clock_pin_base);
+
+#endif
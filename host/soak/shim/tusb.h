@@ -0,0 +1,97 @@
+#ifndef _SOAK_TUSB_H_
+#define _SOAK_TUSB_H_
+
+// The parts of the TinyUSB device API the capture code calls.  The audio IN fifo
+// and the host's isochronous polling are simulated in soak_sim.c; control
+// requests and HID are not exercised.
+
+#include "pico/stdlib.h"
+#include "tusb_config.h"
+
+#define OPT_MCU_RP2040 1100
+#define OPT_MODE_DEVICE 0x0001
+#define OPT_OS_NONE 1
+
+#define TU_U16_HIGH(u16) ((uint8_t)(((u16) >> 8) & 0x00ff))
+#define TU_U16_LOW(u16) ((uint8_t)((u16) & 0x00ff))
+#define TU_VERIFY(cond) do { if (!(cond)) return false; } while (0)
+#define TU_BREAKPOINT() do { } while (0)
+#define TU_LOG2(...) do { } while (0)
+
+typedef struct {
+    uint8_t bmRequestType;
+    uint8_t bRequest;
+    uint16_t wValue;
+    uint16_t wIndex;
+    uint16_t wLength;
+} tusb_control_request_t;
+
+enum {
+    AUDIO20_CS_REQ_CUR = 0x01,
+    AUDIO20_CS_REQ_RANGE = 0x02,
+};
+
+enum {
+    AUDIO20_CS_CTRL_SAM_FREQ = 0x01,
+    AUDIO20_CS_CTRL_CLK_VALID = 0x02,
+};
+
+enum {
+    AUDIO20_TE_CTRL_CONNECTOR = 0x02,
+};
+
+enum {
+    AUDIO20_FU_CTRL_MUTE = 0x01,
+    AUDIO20_FU_CTRL_VOLUME = 0x02,
+};
+
+typedef struct __attribute__((packed)) {
+    int8_t bCur;
+} audio20_control_cur_1_t;
+
+typedef struct __attribute__((packed)) {
+    int16_t bCur;
+} audio20_control_cur_2_t;
+
+typedef struct __attribute__((packed)) {
+    uint8_t bNrChannels;
+    uint32_t bmChannelConfig;
+    uint8_t iChannelNames;
+} audio20_desc_channel_cluster_t;
+
+#define audio20_control_range_2_n_t(numSubRanges) \
+    struct __attribute__((packed)) { uint16_t wNumSubRanges; struct __attribute__((packed)) { int16_t bMin; int16_t bMax; uint16_t bRes; } subrange[numSubRanges]; }
+
+#define audio20_control_range_4_n_t(numSubRanges) \
+    struct __attribute__((packed)) { uint16_t wNumSubRanges; struct __attribute__((packed)) { int32_t bMin; int32_t bMax; uint32_t bRes; } subrange[numSubRanges]; }
+
+typedef enum {
+    HID_REPORT_TYPE_INVALID = 0,
+    HID_REPORT_TYPE_INPUT,
+    HID_REPORT_TYPE_OUTPUT,
+    HID_REPORT_TYPE_FEATURE,
+} hid_report_type_t;
+
+typedef struct soak_usb_fifo tu_fifo_t;
+
+typedef struct {
+    uint16_t len_lin;                       // free bytes from the write pointer to the end of the buffer
+    uint16_t len_wrap;                      // free bytes from the start of the buffer
+    void* ptr_lin;
+    void* ptr_wrap;
+} tu_fifo_buffer_info_t;
+
+bool tusb_init(void);
+void tud_task(void);
+tu_fifo_t* tud_audio_get_ep_in_ff(void);
+void tu_fifo_get_write_info(tu_fifo_t* f, tu_fifo_buffer_info_t* info);
+void tu_fifo_advance_write_pointer(tu_fifo_t* f, uint16_t n);
+bool tud_control_xfer(uint8_t rhport, tusb_control_request_t const* request, void* buffer, uint16_t len);
+bool tud_audio_buffer_and_schedule_control_xfer(uint8_t rhport, tusb_control_request_t const* request, void* data, uint16_t len);
+bool tud_hid_ready(void);
+bool tud_hid_report(uint8_t report_id, void const* report, uint16_t len);
+
+// application callbacks the simulated stack calls
+bool tud_audio_set_itf_cb(uint8_t rhport, tusb_control_request_t const* request);
+
+#endif
@@ -0,0 +1,12 @@
+// The firmware's stereo_usb_mic.c (with stereo_mic_i2s.c) built for the host
+// against the shim headers, without its main() so capture_soak can step the loop.
+// The ring sizes are private to that file and exported here for the checks.
+
+#define CAPTURE_NO_MAIN
+#include "../../stereo_usb_mic.c"
+
+const uint32_t soak_ring_blocks = I2S_PREROLL_BLOCKS;
+
+bool soak_capture_sleeping(void) {
+    return capture_state == CAPTURE_SLEEP;
+}
@@ -0,0 +1,372 @@
+/*
+Simulated Pico SDK and TinyUSB under the capture code, for the soak harness.
+G. Whaley
+
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (C) 2025 The Whaley Group
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ *
+ */
+
+/*
+Only the single PIO state machine, dma channel and audio endpoint the capture code
+uses are modelled, and only as far as their timing shows through the SDK calls.
+
+The dma channel fills its buffer one frame per sample clock tick.  Frames are not
+written as they arrive but in two bulk copies: the frames waiting in the PIO fifo
+when the channel is armed, and the rest when the block completes.  Nothing reads
+the buffer in between, and transfer_count is brought up to date whenever the code
+disables interrupts, which is the only way it reads the dma position.
+
+The temperature sensor and spectrum run on other hardware and core1 and are
+stubbed out; the HID endpoint is never ready, so no reports are sent.
+*/
+
+#include <math.h>
+#include <string.h>
+#include "pico/stdlib.h"
+#include "pico/multicore.h"
+#include "hardware/pio.h"
+#include "hardware/gpio.h"
+#include "hardware/dma.h"
+#include "hardware/irq.h"
+#include "hardware/sync.h"
+#include "hardware/interp.h"
+#include "hardware/structs/systick.h"
+#include "bsp/board_api.h"
+#include "tusb.h"
+#include "stereo_mic_i2s.pio.h"
+#include "temp_sensor.h"
+#include "spectrum.h"
+#include "soak_sim.h"
+
+uint64_t soak_now_ns;
+double soak_frame_ns = 1e9 / MIC_SAMPLE_RATE;
+struct soak_counters soak_counters;
+void (*soak_usb_write_hook)(const void* data, uint16_t len);
+
+pio_hw_t soak_pio0;
+dma_hw_t soak_dma_hw;
+interp_hw_t soak_interp0, soak_interp1;
+systick_hw_t soak_systick;
+uint8_t const desc_hid_report[] = { 0 };
+
+volatile uint16_t spectrum_interval_ms = 0;
+volatile uint32_t spectrum_cycles_per_block = 0;
+
+static uint64_t wfe_until_ns;
+
+
+//--------------------------------------------------------------------+
+// I2S sample clock, PIO fifo and dma channel
+//--------------------------------------------------------------------+
+
+static bool pio_running;
+static dma_channel_hw_t dma_channel;
+static volatile int32_t* dma_dst;
+static uint32_t dma_words;
+static bool dma_armed;
+static uint32_t dma_filled;                 // frames copied from the PIO fifo when the channel was armed
+static uint64_t block_first_tick;           // tick in the first frame of the buffer
+static uint64_t next_tick;                  // next tick the dma takes straight from the PIO
+static uint64_t fifo_first_tick;            // first tick queued in the PIO fifo while the dma is idle
+static bool dma_irq0_enabled, dma_irq_pending;
+static bool dma_nvic_enabled;
+static irq_handler_t dma_irq_handler;
+
+#define BLOCK_FRAMES(words) ((words) / MIC_CHANNELS)
+
+static uint64_t tick_time_ns(uint64_t tick) {
+    return (uint64_t)ceil((double)tick * soak_frame_ns);      // tick_now() reaches tick at this time
+}
+
+uint64_t soak_capture_tick_now(void) {
+    return (uint64_t)((double)soak_now_ns / soak_frame_ns);
+}
+
+static void write_frames(uint32_t pos, uint64_t tick, uint32_t frames) {
+    for (uint32_t f = 0; f < frames; f++) {
+        for (int c = 0; c < MIC_CHANNELS; c++) {
+            dma_dst[(pos + f) * MIC_CHANNELS + c] = soak_frame_sample(tick + f, c);
+        }
+    }
+}
+
+// transfer_count as the hardware would show it now
+static void capture_sync(void) {
+    if (!pio_running || !dma_armed) return;
+    uint64_t now = soak_capture_tick_now();
+    uint64_t frames = dma_filled + (now >= next_tick ? now - next_tick + 1 : 0);
+    if (frames > BLOCK_FRAMES(dma_words)) frames = BLOCK_FRAMES(dma_words);
+    dma_channel.transfer_count = dma_words - (uint32_t)frames * MIC_CHANNELS;
+}
+
+uint64_t soak_capture_completion_ns(void) {
+    if (!pio_running || !dma_armed) return SOAK_NEVER;
+    return tick_time_ns(next_tick + (BLOCK_FRAMES(dma_words) - dma_filled) - 1);
+}
+
+void soak_capture_complete(uint64_t* first_tick, uint64_t* last_tick) {
+    uint32_t frames = BLOCK_FRAMES(dma_words) - dma_filled;
+    write_frames(dma_filled, next_tick, frames);
+    *first_tick = dma_filled ? block_first_tick : next_tick;
+    *last_tick = next_tick + frames - 1;
+    next_tick += frames;
+    fifo_first_tick = next_tick;
+    dma_armed = false;
+    dma_channel.transfer_count = 0;
+    dma_irq_pending = true;
+}
+
+bool soak_capture_irq_pending(void) {
+    return dma_irq_pending && dma_irq0_enabled && dma_nvic_enabled;
+}
+
+void soak_capture_irq(void) {
+    if (!soak_capture_irq_pending() || dma_irq_handler == NULL) return;
+    dma_irq_pending = false;
+    dma_irq_handler();
+}
+
+void pio_sm_set_enabled(PIO pio, uint sm, bool enabled) {
+    (void) pio; (void) sm;
+    if (enabled == pio_running) return;
+    pio_running = enabled;
+    if (enabled) {
+        next_tick = soak_capture_tick_now() + 1;
+        fifo_first_tick = next_tick;
+        block_first_tick = next_tick;
+        dma_filled = 0;
+    }
+}
+
+void dma_channel_transfer_to_buffer_now(uint channel, volatile void* write_addr, uint32_t transfer_count) {
+    (void) channel;
+    dma_dst = (volatile int32_t *)write_addr;
+    dma_words = transfer_count;
+    dma_armed = true;
+    dma_filled = 0;
+    block_first_tick = next_tick;
+    if (pio_running) {
+        // the fifo has been filling since the last block completed, and stalled the PIO once full
+        uint64_t now = soak_capture_tick_now();
+        uint64_t queued = now >= fifo_first_tick ? now - fifo_first_tick + 1 : 0;
+        uint32_t kept = queued > SOAK_PIO_FIFO_FRAMES ? SOAK_PIO_FIFO_FRAMES : (uint32_t)queued;
+        if (queued > SOAK_PIO_FIFO_FRAMES) {
+            soak_counters.pio_overflows++;
+            soak_counters.pio_frames_lost += queued - SOAK_PIO_FIFO_FRAMES;
+        }
+        if (kept > soak_counters.pio_fifo_high_water) soak_counters.pio_fifo_high_water = kept;
+        write_frames(0, fifo_first_tick, kept);
+        block_first_tick = fifo_first_tick;
+        dma_filled = kept;
+        if (queued) next_tick = now + 1;
+    }
+    dma_channel.transfer_count = transfer_count - dma_filled * MIC_CHANNELS;
+}
+
+void dma_channel_configure(uint channel, const dma_channel_config* config, volatile void* write_addr,
+                           const volatile void* read_addr, uint transfer_count, bool trigger) {
+    (void) config; (void) read_addr;
+    dma_dst = (volatile int32_t *)write_addr;
+    dma_words = transfer_count;
+    if (trigger) dma_channel_transfer_to_buffer_now(channel, write_addr, transfer_count);
+}
+
+void dma_channel_abort(uint channel) {
+    (void) channel;
+    dma_armed = false;
+    dma_irq_pending = false;
+}
+
+void dma_channel_start(uint channel) { (void) channel; }
+dma_channel_hw_t* dma_channel_hw_addr(uint channel) { (void) channel; return &dma_channel; }
+int dma_claim_unused_channel(bool required) { (void) required; return 0; }
+void dma_channel_set_irq0_enabled(uint channel, bool enabled) { (void) channel; dma_irq0_enabled = enabled; }
+
+void irq_set_exclusive_handler(uint num, irq_handler_t handler) {
+    if (num == DMA_IRQ_0) dma_irq_handler = handler;
+}
+
+void irq_set_enabled(uint num, bool enabled) {
+    if (num == DMA_IRQ_0) dma_nvic_enabled = enabled;
+}
+
+// interrupts are events between main loop steps, so masking them only has to
+// give the code a current view of the dma position
+uint32_t save_and_disable_interrupts(void) {
+    capture_sync();
+    return 0;
+}
+
+void restore_interrupts(uint32_t status) { (void) status; }
+
+uint pio_add_program(PIO pio, const pio_program_t* program) { (void) pio; (void) program; return 0; }
+void i2s_mic_program_init(PIO pio, uint sm, uint offset, uint data_pin, uint clock_pin_base) {
+    (void) pio; (void) sm; (void) offset; (void) data_pin; (void) clock_pin_base;
+}
+void pio_sm_clear_fifos(PIO pio, uint sm) { (void) pio; (void) sm; }
+void pio_sm_restart(PIO pio, uint sm) { (void) pio; (void) sm; }
+void pio_sm_exec(PIO pio, uint sm, uint instr) { (void) pio; (void) sm; (void) instr; }
+void pio_sm_set_pins_with_mask(PIO pio, uint sm, uint32_t values, uint32_t mask) {
+    (void) pio; (void) sm; (void) values; (void) mask;
+}
+
+
+//--------------------------------------------------------------------+
+// TinyUSB audio IN fifo and isochronous endpoint
+//--------------------------------------------------------------------+
+
+static uint8_t usb_fifo[SOAK_USB_FIFO_BYTES];
+static uint32_t usb_fifo_rd, usb_fifo_count;
+static uint8_t usb_packet[CFG_TUD_AUDIO_EP_SZ_IN];
+static int usb_packet_len = -1;             // -1 = endpoint not armed
+static bool usb_tx_done;                    // transfer complete event waiting for tud_task()
+static uint8_t usb_alt;
+
+uint32_t soak_usb_fifo_count(void) {
+    return usb_fifo_count;
+}
+
+// the capture code only sees the fifo through the handle, there is one IN fifo
+tu_fifo_t* tud_audio_get_ep_in_ff(void) {
+    return (tu_fifo_t *)usb_fifo;
+}
+
+void tu_fifo_get_write_info(tu_fifo_t* f, tu_fifo_buffer_info_t* info) {
+    (void) f;
+    uint32_t wr = (usb_fifo_rd + usb_fifo_count) % SOAK_USB_FIFO_BYTES;
+    uint32_t free = SOAK_USB_FIFO_BYTES - usb_fifo_count;
+    uint32_t lin = SOAK_USB_FIFO_BYTES - wr < free ? SOAK_USB_FIFO_BYTES - wr : free;
+    info->len_lin = (uint16_t)lin;
+    info->len_wrap = (uint16_t)(free - lin);
+    info->ptr_lin = &usb_fifo[wr];
+    info->ptr_wrap = usb_fifo;
+}
+
+// bytes written in place become visible to the driver here
+void tu_fifo_advance_write_pointer(tu_fifo_t* f, uint16_t n) {
+    (void) f;
+    uint32_t wr = (usb_fifo_rd + usb_fifo_count) % SOAK_USB_FIFO_BYTES;
+    uint32_t free = SOAK_USB_FIFO_BYTES - usb_fifo_count;
+    if (soak_usb_write_hook) soak_usb_write_hook(&usb_fifo[wr], (uint16_t)(SOAK_USB_FIFO_BYTES - wr < n ? SOAK_USB_FIFO_BYTES - wr : n));
+    soak_counters.usb_writes++;
+    if (n > free) {                         // the real fifo would overwrite data the host has not read
+        soak_counters.usb_bytes_dropped += n - free;
+        n = (uint16_t)free;
+    }
+    usb_fifo_count += n;
+    if (usb_fifo_count > soak_counters.usb_fifo_high_water) soak_counters.usb_fifo_high_water = usb_fifo_count;
+}
+
+// the audio driver loads the next packet from the fifo once the last one has gone
+void tud_task(void) {
+    if (usb_alt == 0 || !usb_tx_done) return;
+    uint32_t n = usb_fifo_count < sizeof(usb_packet) ? usb_fifo_count : sizeof(usb_packet);
+    for (uint32_t i = 0; i < n; i++) {
+        usb_packet[i] = usb_fifo[(usb_fifo_rd + i) % SOAK_USB_FIFO_BYTES];
+    }
+    usb_fifo_rd = (usb_fifo_rd + n) % SOAK_USB_FIFO_BYTES;
+    usb_fifo_count -= n;
+    usb_packet_len = (int)n;
+    usb_tx_done = false;
+}
+
+int soak_usb_sof(uint8_t* packet) {
+    if (usb_alt == 0) return -1;
+    if (usb_packet_len < 0) {
+        soak_counters.usb_polls_missed++;
+        return -1;
+    }
+    int n = usb_packet_len;
+    memcpy(packet, usb_packet, (size_t)n);
+    usb_packet_len = -1;
+    usb_tx_done = true;
+    return n;
+}
+
+void soak_usb_set_alt(uint8_t alt) {
+    usb_alt = alt;
+    usb_fifo_rd = 0;                        // the driver clears the fifo on every set interface
+    usb_fifo_count = 0;
+    usb_packet_len = -1;
+    usb_tx_done = (alt != 0);
+    tusb_control_request_t request = { .bmRequestType = 0x01, .bRequest = 0x0B, .wValue = alt, .wIndex = 1 };
+    tud_audio_set_itf_cb(0, &request);
+}
+
+bool tusb_init(void) { return true; }
+bool tud_control_xfer(uint8_t rhport, tusb_control_request_t const* request, void* buffer, uint16_t len) {
+    (void) rhport; (void) request; (void) buffer; (void) len;
+    return true;
+}
+bool tud_audio_buffer_and_schedule_control_xfer(uint8_t rhport, tusb_control_request_t const* request, void* data, uint16_t len) {
+    (void) rhport; (void) request; (void) data; (void) len;
+    return true;
+}
+bool tud_hid_ready(void) { return false; }
+bool tud_hid_report(uint8_t report_id, void const* report, uint16_t len) {
+    (void) report_id; (void) report; (void) len;
+    return false;
+}
+
+
+//--------------------------------------------------------------------+
+// Time, main loop sleep and the rest of the board
+//--------------------------------------------------------------------+
+
+absolute_time_t get_absolute_time(void) { return soak_now_ns / 1000; }
+absolute_time_t make_timeout_time_ms(uint32_t ms) { return get_absolute_time() + (uint64_t)ms * 1000; }
+
+bool best_effort_wfe_or_timeout(absolute_time_t timeout) {
+    wfe_until_ns = timeout * 1000;
+    return false;
+}
+
+uint64_t soak_wfe_until_ns(void) {
+    uint64_t t = wfe_until_ns;
+    wfe_until_ns = 0;
+    return t;
+}
+
+void sleep_us(uint64_t us) { (void) us; }
+bool stdio_init_all(void) { return true; }
+void multicore_launch_core1(void (*entry)(void)) { (void) entry; }
+void board_init(void) { }
+void board_led_write(bool state) { (void) state; }
+
+void gpio_init(uint gpio) { (void) gpio; }
+void gpio_set_dir(uint gpio, bool out) { (void) gpio; (void) out; }
+void gpio_pull_down(uint gpio) { (void) gpio; }
+bool gpio_get(uint gpio) { (void) gpio; return false; }
+void gpio_set_irq_enabled_with_callback(uint gpio, uint32_t event_mask, bool enabled, gpio_irq_callback_t callback) {
+    (void) gpio; (void) event_mask; (void) enabled; (void) callback;
+}
+
+void temp_sensor_init(void) { }
+int16_t temp_sensor_read(void) { return 2500; }
+
+void spectrum_init(void) { }
+void spectrum_add_block(const int (*block)[MIC_CHANNELS], int frames) { (void) block; (void) frames; }
+void spectrum_reset(void) { }
+bool spectrum_take_report(uint8_t* report) { (void) report; return false; }
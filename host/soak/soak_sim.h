@@ -0,0 +1,103 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (C) 2025 The Whaley Group
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#ifndef _SOAK_SIM_H_
+#define _SOAK_SIM_H_
+
+// Simulated hardware under the capture code, driven by capture_soak.cpp.
+//
+// Time is in nanoseconds and only moves when the harness sets soak_now_ns.  The
+// I2S sample clock ticks every soak_frame_ns; tick k carries soak_frame_sample(k).
+// The PIO RX fifo holds SOAK_PIO_FIFO_FRAMES frames while the dma is not armed,
+// and a full fifo stalls the state machine, so the frames after it are lost.
+// The audio IN fifo behaves like TinyUSB's: the capture code writes in place and
+// advances the write pointer, tud_task() loads the next isochronous packet, and the
+// host takes it at its SOF.
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "mic_config.h"
+#include "tusb_config.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SOAK_PIO_FIFO_FRAMES (8 / MIC_CHANNELS)     // joined RX fifo, 8 words
+#define SOAK_USB_FIFO_BYTES (CFG_TUD_AUDIO_FUNC_1_EP_IN_SW_BUF_SZ)
+#define SOAK_NEVER UINT64_MAX
+
+#define SOAK_COUNTER_BITS 24                        // frame counter carried in each sample
+
+#if MIC_SAMPLE_BITS < SOAK_COUNTER_BITS || MIC_BYTES_PER_SAMPLE < 3
+#error "the soak frame counter needs 24 bit samples on the wire"
+#endif
+
+// Left carries (tick + 1) in the top 24 bits, right its complement, so no frame is
+// all zero.  The bits below MIC_SAMPLE_BITS are noise the capture code must drop.
+static inline int32_t soak_frame_sample(uint64_t tick, int channel) {
+    uint32_t v = (uint32_t)(tick + 1) & 0xFFFFFFu;
+    if (channel & 1) v = ~v & 0xFFFFFFu;
+    uint32_t noise = (uint32_t)(tick * 2654435761u + channel) >> 24;
+    return (int32_t)((v << 8) | noise);
+}
+
+extern uint64_t soak_now_ns;
+extern double soak_frame_ns;                        // device sample period
+
+struct soak_counters {
+    uint64_t pio_overflows;                         // dma restarted after the fifo had filled
+    uint64_t pio_frames_lost;
+    uint32_t pio_fifo_high_water;                   // frames
+    uint64_t usb_writes;
+    uint64_t usb_bytes_dropped;                     // write pointer advanced past the free space
+    uint32_t usb_fifo_high_water;                   // bytes
+    uint64_t usb_polls_missed;                      // SOF with no packet armed
+};
+extern struct soak_counters soak_counters;
+
+// capture side
+uint64_t soak_capture_completion_ns(void);          // end of the block in flight, SOAK_NEVER if none
+void soak_capture_complete(uint64_t* first_tick, uint64_t* last_tick);     // at that time: fill the buffer, raise the irq
+bool soak_capture_irq_pending(void);
+void soak_capture_irq(void);                        // run the dma handler now, if still pending and enabled
+uint64_t soak_capture_tick_now(void);               // last sample clock tick at or before now
+
+// USB side
+void soak_usb_set_alt(uint8_t alt);                 // host selects the streaming alt setting
+int soak_usb_sof(uint8_t* packet);                  // bytes the host receives this frame, -1 if none was armed
+uint32_t soak_usb_fifo_count(void);
+
+// main loop
+uint64_t soak_wfe_until_ns(void);                   // set by best_effort_wfe_or_timeout(), 0 if the loop did not sleep
+
+// called from tu_fifo_advance_write_pointer() with the bytes being committed
+extern void (*soak_usb_write_hook)(const void* data, uint16_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,157 @@
+/*
+Verify the firmware test pattern stream and measure sustained throughput.
+G. Whaley
+
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (C) 2025 The Whaley Group
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ *
+ */
+
+/*
+Usage:  stream_verify [options]
+    --source NAME      alsa:DEVICE, a raw SE_32 file/pipe, or - for stdin (default -)
+    --channels N       channels in the stream (default 2)
+    --rate HZ          nominal sample rate (default 48000)
+    --pattern P        counter or sweep, as selected in the firmware (default counter)
+    --seconds S        stop after S seconds, 0 = until end of stream (default 0)
+    --interval S       seconds between progress lines (default 1)
+
+Put the device in test signal mode first (build with TEST_SIGNAL_DEFAULT, or set
+HID feature report 6), then e.g.
+    stream_verify --source alsa:hw:MicArray --pattern counter --seconds 3600
+
+Every received frame is compared with the pattern regenerated from test_pattern.h,
+and matched, silent, dropped, repeated and corrupt frames are counted as described
+in pattern_verifier.h.  The counter pattern needs SE_32 samples, since 24 and 16
+bit builds drop the channel byte; such a stream is reported and the run stops.
+
+The exit status is 0 only if no frames were dropped, repeated or corrupt.
+*/
+
+#include "capture_source.h"
+#include "pattern_verifier.h"
+
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+using namespace micarray;
+
+static volatile std::sig_atomic_t stop_requested = 0;
+
+static void on_signal(int) {
+    stop_requested = 1;
+}
+
+static void print_stats(const char* label, const VerifyStats& s, double seconds, uint32_t channels, uint32_t rate) {
+    double fps = seconds > 0 ? s.frames / seconds : 0.0;
+    double ppm = rate ? (fps / rate - 1.0) * 1e6 : 0.0;
+    std::printf("%s %8.1f s  frames %llu  ok %llu  silent %llu  dropped %llu  repeated %llu  corrupt %llu  "
+                "locks %llu  %.1f frames/s (%+.0f ppm)  %.3f MB/s\n",
+                label, seconds, (unsigned long long)s.frames, (unsigned long long)s.matched,
+                (unsigned long long)s.silent, (unsigned long long)s.dropped, (unsigned long long)s.repeated,
+                (unsigned long long)s.corrupt, (unsigned long long)s.locks, fps, ppm,
+                fps * channels * sizeof(int32_t) / 1e6);
+    std::fflush(stdout);
+}
+
+int main(int argc, char** argv) {
+    std::string source_name = "-";
+    uint32_t channels = 2;
+    uint32_t rate = 48000;
+    int pattern = TEST_PATTERN_COUNTER;
+    double seconds = 0.0;
+    double interval = 1.0;
+
+    for (int i = 1; i < argc; i++) {
+        std::string a = argv[i];
+        auto next = [&]() -> const char* {
+            if (i + 1 >= argc) { std::fprintf(stderr, "missing value for %s\n", a.c_str()); std::exit(2); }
+            return argv[++i];
+        };
+        if (a == "--source") source_name = next();
+        else if (a == "--channels") channels = std::strtoul(next(), nullptr, 0);
+        else if (a == "--rate") rate = std::strtoul(next(), nullptr, 0);
+        else if (a == "--seconds") seconds = std::atof(next());
+        else if (a == "--interval") interval = std::atof(next());
+        else if (a == "--pattern") {
+            std::string p = next();
+            if (p == "counter") pattern = TEST_PATTERN_COUNTER;
+            else if (p == "sweep") pattern = TEST_PATTERN_SWEEP;
+            else { std::fprintf(stderr, "unknown pattern %s\n", p.c_str()); return 2; }
+        }
+        else { std::fprintf(stderr, "unknown option %s\n", a.c_str()); return 2; }
+    }
+    if (channels == 0 || channels > TEST_PATTERN_MAX_CHANNELS) {
+        std::fprintf(stderr, "--channels must be 1 to %d\n", TEST_PATTERN_MAX_CHANNELS);
+        return 2;
+    }
+
+    std::unique_ptr<CaptureSource> source = open_source(source_name, channels, rate);
+    if (!source) {
+        std::fprintf(stderr, "cannot open source %s\n", source_name.c_str());
+        return 1;
+    }
+    std::signal(SIGINT, on_signal);
+    std::signal(SIGTERM, on_signal);
+
+    PatternVerifier verifier(pattern, (int)channels);
+    PatternReader reader((int)channels, rate / 100);                // 10 ms per read
+    VerifyStats stats;
+
+    using clock = std::chrono::steady_clock;
+    clock::time_point start;
+    bool started = false;
+    double next_print = interval;
+    double elapsed = 0.0;
+
+    while (!stop_requested) {
+        if (!reader.read(source.get(), &verifier, &stats)) break;
+        clock::time_point now = clock::now();
+        if (!started) {                                             // time from the first data, not from open
+            start = now;
+            started = true;
+        }
+        elapsed = std::chrono::duration<double>(now - start).count();
+
+        if (verifier.channel_byte_missing()) {
+            std::fprintf(stderr, "the counter pattern arrives without its channel byte: the device sends 24 or 16 bit "
+                                 "samples (MIC_BYTES_PER_SAMPLE 3 or 2), and the counter needs a 32 bit build\n");
+            return 2;
+        }
+
+        if (interval > 0 && elapsed >= next_print) {
+            print_stats("   ", stats, elapsed, channels, rate);
+            next_print += interval;
+        }
+        if (seconds > 0 && elapsed >= seconds) break;
+    }
+    print_stats("end", stats, elapsed, channels, rate);
+    bool clean = stats.locks > 0 && stats.dropped == 0 && stats.repeated == 0 && stats.corrupt == 0;
+    return clean ? 0 : 1;
+}
@@ -0,0 +1,243 @@
+/*
+Host test of the beamformer kernels and beams (beamformer.cpp, beam_kernels_avx2.cpp).
+G. Whaley
+
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (C) 2025 The Whaley Group
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ *
+ */
+
+/*
+    kernels   delay_accumulate_avx2, fir_accumulate_avx2 and deinterleave_se32_avx2
+              against their portable versions, for frame counts on and off every
+              vector and unroll boundary, with every pointer offset by 0 to 7
+              floats from 32 byte alignment, and for delays 0, 1 and the largest
+              steering delay of the default two microphone geometry.  The
+              deinterleave must match bit for bit; the accumulating kernels use
+              FMA, so they are held to a few float roundings of their output.
+              Skipped, and reported as such, when the CPU has no AVX2 or FMA.
+    beams     a plane wave of three tones from 30 degrees on an eight microphone
+              line, through delay-and-sum and filter-and-sum beams every 5 degrees
+              from -90 to 90, with and without the AVX2 kernels.  The 30 degree
+              beam must have the most power, and the two kernel sets must agree.
+
+Exits non-zero on any failure.
+*/
+
+#include "beamformer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <vector>
+
+using namespace micarray;
+
+namespace {
+
+const double PI = 3.14159265358979323846;
+constexpr size_t kFrameCounts[] = { 1, 3, 7, 8, 9, 31, 32, 33, 39, 63, 480, 1001 };
+constexpr int kAlign = 8;                                   // floats in 32 bytes
+constexpr int kTaps = 32;
+constexpr float kTolerance = 2e-6f;                         // 8 roundings of values within [-2, 2]
+
+int failures = 0;
+
+void check(bool ok, const char* what) {
+    if (!ok) {
+        std::printf("FAIL %s\n", what);
+        failures++;
+    }
+}
+
+// a buffer with room for kAlign offsets, its first float 32 byte aligned
+struct Aligned {
+    std::vector<float> store;
+    float* base;
+
+    explicit Aligned(size_t n) : store(n + 2 * kAlign) {
+        base = store.data() + (kAlign - ((uintptr_t)store.data() / sizeof(float)) % kAlign) % kAlign;
+    }
+};
+
+std::vector<float> noise(size_t n, uint32_t seed) {
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<float> u(-1.0f, 1.0f);
+    std::vector<float> v(n);
+    for (float& x : v) x = u(rng);
+    return v;
+}
+
+float max_error(const float* a, const float* b, size_t n) {
+    float e = 0.0f;
+    for (size_t i = 0; i < n; i++) e = std::max(e, std::fabs(a[i] - b[i]));
+    return e;
+}
+
+void test_delay(int max_delay) {
+    const size_t history = max_delay + 1, longest = kFrameCounts[sizeof(kFrameCounts) / sizeof(kFrameCounts[0]) - 1];
+    std::vector<float> input = noise(history + longest + kAlign, 1), start = noise(longest, 2);
+    Aligned x(history + longest), c(longest), avx(longest);
+    std::copy(input.begin(), input.end(), x.base);
+    float worst = 0.0f;
+    for (int d : { 0, 1, max_delay }) {
+        for (size_t frames : kFrameCounts) {
+            for (int off = 0; off < kAlign; off++) {
+                const float* in = x.base + history + off;
+                std::copy(start.begin(), start.begin() + frames, c.base + off);
+                std::copy(start.begin(), start.begin() + frames, avx.base + off);
+                kernels::delay_accumulate(c.base + off, in, frames, d, 0.375f, 0.625f);
+                kernels::delay_accumulate_avx2(avx.base + off, in, frames, d, 0.375f, 0.625f);
+                worst = std::max(worst, max_error(c.base + off, avx.base + off, frames));
+            }
+        }
+    }
+    check(worst <= kTolerance, "delay_accumulate_avx2 matches delay_accumulate");
+    std::printf("delay_accumulate_avx2 max error %.1e\n", worst);
+}
+
+void test_fir(int max_delay) {
+    const size_t history = max_delay + kTaps, longest = kFrameCounts[sizeof(kFrameCounts) / sizeof(kFrameCounts[0]) - 1];
+    std::vector<float> input = noise(history + longest + kAlign, 3), start = noise(longest, 4), taps = noise(kTaps, 5);
+    for (float& h : taps) h /= kTaps;                       // keep the sums within [-2, 2]
+    Aligned x(history + longest), c(longest), avx(longest);
+    std::copy(input.begin(), input.end(), x.base);
+    float worst = 0.0f;
+    for (int d : { 0, 1, max_delay }) {
+        for (size_t frames : kFrameCounts) {
+            for (int off = 0; off < kAlign; off++) {
+                const float* in = x.base + history + off - d;     // the integer delay, as form_beam() applies it
+                std::copy(start.begin(), start.begin() + frames, c.base + off);
+                std::copy(start.begin(), start.begin() + frames, avx.base + off);
+                kernels::fir_accumulate(c.base + off, in, frames, taps.data(), kTaps);
+                kernels::fir_accumulate_avx2(avx.base + off, in, frames, taps.data(), kTaps);
+                worst = std::max(worst, max_error(c.base + off, avx.base + off, frames));
+            }
+        }
+    }
+    check(worst <= kTolerance, "fir_accumulate_avx2 matches fir_accumulate");
+    std::printf("fir_accumulate_avx2 max error %.1e\n", worst);
+}
+
+void test_deinterleave() {
+    const size_t longest = kFrameCounts[sizeof(kFrameCounts) / sizeof(kFrameCounts[0]) - 1];
+    std::mt19937 rng(6);
+    bool ok = true;
+    for (int channels : { 2, 3 }) {                         // the shuffle kernel, and the fallback
+        std::vector<int32_t> words(longest * channels + kAlign);
+        for (int32_t& w : words) w = (int32_t)rng();
+        words[0] = INT32_MIN;
+        words[1] = INT32_MAX;
+        for (size_t frames : kFrameCounts) {
+            for (int off = 0; off < kAlign; off++) {
+                std::vector<float> c(channels * longest), avx(channels * longest + kAlign);
+                std::vector<float*> c_out(channels), avx_out(channels);
+                for (int ch = 0; ch < channels; ch++) {
+                    c_out[ch] = c.data() + ch * longest;
+                    avx_out[ch] = avx.data() + ch * longest + off;
+                }
+                deinterleave_se32(words.data() + off, frames, channels, c_out.data());
+                kernels::deinterleave_se32_avx2(words.data() + off, frames, channels, avx_out.data());
+                for (int ch = 0; ch < channels; ch++) {
+                    ok = ok && std::memcmp(c_out[ch], avx_out[ch], frames * sizeof(float)) == 0;
+                }
+            }
+        }
+    }
+    check(ok, "deinterleave_se32_avx2 matches deinterleave_se32");
+}
+
+// Beam power for a plane wave from `from`; element ch hears it steering_delay() -
+// max/2 samples early, as in beam_bench.
+std::vector<double> beam_powers(BeamType type, bool simd, double from, std::vector<float>* last_block) {
+    BeamformerConfig cfg;
+    cfg.geometry.channels = 8;
+    cfg.geometry.spacing_m = 0.04;                          // half a wavelength at 4.3 kHz
+    cfg.type = type;
+    cfg.threads = 1;
+    cfg.use_simd = simd;
+    for (int deg = -90; deg <= 90; deg += 5) cfg.steer_angles_rad.push_back(deg * PI / 180.0);
+    Beamformer bf(cfg);
+
+    const ArrayGeometry& g = cfg.geometry;
+    const int blocks = 24, settle = 4;
+    const size_t frames = cfg.block_frames;
+    std::vector<int32_t> block(frames * g.channels);
+    std::vector<double> power(bf.beams(), 0.0);
+    for (int k = 0; k < blocks; k++) {
+        for (int ch = 0; ch < g.channels; ch++) {
+            double lead = g.steering_delay(ch, from) - g.max_steering_delay() / 2.0;
+            for (size_t n = 0; n < frames; n++) {
+                double t = (k * frames + n + lead) / g.sample_rate, v = 0.0;
+                for (double f : { 700.0, 1500.0, 2900.0 }) v += 0.25 * std::sin(2.0 * PI * f * t);
+                block[n * g.channels + ch] = (int32_t)std::lrint(v * 2147483647.0) & (int32_t)0xFFFFFF00;
+            }
+        }
+        bf.process(block.data());
+        if (k < settle) continue;
+        for (size_t b = 0; b < bf.beams(); b++) {
+            for (size_t n = 0; n < frames; n++) power[b] += (double)bf.beam(b)[n] * bf.beam(b)[n];
+        }
+    }
+    last_block->clear();
+    for (size_t b = 0; b < bf.beams(); b++) last_block->insert(last_block->end(), bf.beam(b), bf.beam(b) + frames);
+    return power;
+}
+
+void test_beams(BeamType type, const char* name) {
+    const double from = 30.0 * PI / 180.0;
+    const int want = (30 + 90) / 5;
+    std::vector<float> c_out, avx_out;
+    std::vector<double> c = beam_powers(type, false, from, &c_out);
+    std::vector<double> avx = beam_powers(type, true, from, &avx_out);
+    int peak = (int)(std::max_element(c.begin(), c.end()) - c.begin());
+    int avx_peak = (int)(std::max_element(avx.begin(), avx.end()) - avx.begin());
+    char what[96];
+    std::snprintf(what, sizeof(what), "%s peaks at the 30 degree beam", name);
+    check(peak == want && avx_peak == want, what);
+    std::snprintf(what, sizeof(what), "%s beams agree with and without AVX2", name);
+    check(max_error(c_out.data(), avx_out.data(), c_out.size()) <= kTolerance, what);
+    std::printf("%s peak %d degrees, %.2f dB over the 25 and 35 degree beams\n", name, peak * 5 - 90,
+                10.0 * std::log10(c[want] / std::max(c[want - 1], c[want + 1])));
+}
+
+}  // namespace
+
+int main() {
+    const int max_delay = (int)std::ceil(ArrayGeometry().max_steering_delay());
+    if (simd_available()) {
+        test_delay(max_delay);
+        test_fir(max_delay);
+        test_deinterleave();
+    } else {
+        std::printf("no AVX2 on this CPU or build, kernel comparisons skipped\n");
+    }
+    test_beams(BeamType::DelayAndSum, "delay-and-sum");
+    test_beams(BeamType::FilterAndSum, "filter-and-sum");
+
+    std::printf("beamformer: %s\n", failures ? "FAIL" : "PASS");
+    return failures ? 1 : 0;
+}
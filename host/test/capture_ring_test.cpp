@@ -0,0 +1,382 @@
+/*
+Host test of the capture ring (capture_ring.cpp) and the file and pipe sources.
+G. Whaley
+
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (C) 2025 The Whaley Group
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ *
+ */
+
+/*
+Every sample of the stream holds its frame index in bits 31-8 and its channel in
+the low byte, and every metadata update holds fields derived from its frame, so a
+reader can check each sample it accepts and each metadata copy on its own.  The
+ring file, the stream file and the fifo are made in a temporary directory.
+
+    pipe      a known SE_32 stream is written into a fifo in odd sized pieces, so
+              frames arrive split, and captured through open_source() into the
+              ring as micarray_capture does, with a metadata update per read.
+              Several readers, each with its own mapping, run concurrently across
+              many wraps; the feeder keeps within a quarter ring of the slowest,
+              so every reader must see every frame in order, no overrun, and only
+              whole metadata updates, in order.
+    file      the same stream from a file, with the writer unpaced and readers
+              that hold their views for a while, so they get lapped.  No view a
+              reader was allowed to keep may differ from the stream.
+    overrun   single threaded: a reader left a whole ring behind is reported as
+              overrun and moved to the oldest intact frame; a view the writer
+              overwrote or reserved while it was in use is refused by release().
+    sharing   create() refuses a ring another writer or a reader has open.
+    sources   a trailing partial frame is not returned, a missing file does not
+              open, and the HID input report decodes.
+
+Exits non-zero on any failure.
+*/
+
+#include "capture_ring.h"
+#include "capture_source.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace micarray;
+
+namespace {
+
+constexpr uint32_t kChannels = 2;
+constexpr uint32_t kRate = 48000;
+constexpr uint64_t kCapacity = 16384;                       // frames, a power of two
+constexpr uint64_t kPipeFrames = 300000;                    // 18 wraps
+constexpr uint64_t kFileFrames = 1000000;
+constexpr int kReaders = 3;
+
+int failures = 0;
+
+void check(bool ok, const char* what) {
+    if (!ok) {
+        std::printf("FAIL %s\n", what);
+        failures++;
+    }
+}
+
+int32_t sample(uint64_t frame, uint32_t ch) {
+    return (int32_t)(((uint32_t)frame << 8) | ch);
+}
+
+RingMetadata tag(uint64_t frame) {
+    RingMetadata m;
+    m.temperature_centi_c = (int16_t)(frame * 7);
+    m.mic_distance_mm = (int16_t)(frame >> 3);
+    m.frame = frame;
+    m.time_ns = frame * 1000 + 1;
+    return m;
+}
+
+bool tag_ok(const RingMetadata& m) {
+    RingMetadata want = tag(m.frame);
+    return m.temperature_centi_c == want.temperature_centi_c && m.mic_distance_mm == want.mic_distance_mm &&
+           m.time_ns == want.time_ns;
+}
+
+bool frames_ok(const int32_t* p, uint64_t first, size_t frames) {
+    for (size_t i = 0; i < frames; i++) {
+        for (uint32_t c = 0; c < kChannels; c++) {
+            if (p[i * kChannels + c] != sample(first + i, c)) return false;
+        }
+    }
+    return true;
+}
+
+std::vector<int32_t> stream(uint64_t first, uint64_t frames) {
+    std::vector<int32_t> v(frames * kChannels);
+    for (uint64_t i = 0; i < frames; i++) {
+        for (uint32_t c = 0; c < kChannels; c++) v[i * kChannels + c] = sample(first + i, c);
+    }
+    return v;
+}
+
+// what micarray_capture does, plus a tagged metadata update after every read
+uint64_t capture(CaptureSource& source, RingWriter& ring) {
+    while (true) {
+        size_t room;
+        int32_t* dst = ring.acquire(kRate / 100, &room);
+        long n = source.read(dst, room);
+        if (n <= 0) break;
+        ring.commit((size_t)n);
+        ring.set_metadata(tag(ring.frames_written()));
+    }
+    return ring.frames_written();
+}
+
+struct ReaderResult {
+    std::atomic<uint64_t> cursor{0};
+    uint64_t accepted = 0;
+    uint64_t bad = 0;                                       // accepted frames that were not the stream
+    uint64_t out_of_order = 0;
+    uint64_t overruns = 0;
+    uint64_t meta_seen = 0;
+    uint64_t meta_bad = 0;
+};
+
+// read until the cursor reaches total, checking every frame and metadata copy
+void read_ring(const std::string& path, uint64_t total, unsigned seed, int hold_us, ReaderResult* r) {
+    RingReader ring;
+    if (!ring.open(path)) {
+        r->bad = total;
+        r->cursor = total;
+        return;
+    }
+    ring.seek_oldest();
+    uint64_t next = 0, last_meta = 0;
+    while (ring.cursor() < total) {
+        size_t n;
+        size_t want = 1 + (seed = seed * 1103515245u + 12345u) % 997;
+        const int32_t* p = ring.view(want, &n);
+        if (n == 0) {
+            std::this_thread::yield();
+            continue;
+        }
+        uint64_t at = ring.cursor();                        // after any overrun view() skipped
+        bool ok = frames_ok(p, at, n);
+        if (hold_us) std::this_thread::sleep_for(std::chrono::microseconds(hold_us));
+        if (ring.release(n)) {
+            r->accepted += n;
+            if (!ok) r->bad += n;
+            if (at < next) r->out_of_order++;
+            next = at + n;
+        }
+        r->cursor = ring.cursor();
+
+        RingMetadata meta;
+        if (ring.metadata(&meta)) {
+            r->meta_seen++;
+            if (!tag_ok(meta) || meta.frame < last_meta) r->meta_bad++;
+            last_meta = meta.frame;
+        }
+    }
+    r->overruns = ring.overruns();
+}
+
+struct TempDir {
+    std::string path;
+    TempDir() {
+        char name[] = "/tmp/micarray_ring_XXXXXX";
+        if (mkdtemp(name)) path = name;
+    }
+    ~TempDir() {
+        if (!path.empty()) std::filesystem::remove_all(path);
+    }
+};
+
+void test_pipe(const std::string& dir) {
+    std::string ring_path = dir + "/pipe.ring", fifo = dir + "/stream.fifo";
+    check(mkfifo(fifo.c_str(), 0600) == 0, "pipe fifo created");
+    RingWriter writer;
+    check(writer.create(ring_path, kChannels, kRate, kCapacity), "pipe ring created");
+
+    ReaderResult results[kReaders];
+    std::vector<std::thread> readers;
+    for (int i = 0; i < kReaders; i++) {
+        readers.emplace_back(read_ring, ring_path, kPipeFrames, 1u + i, 0, &results[i]);
+    }
+
+    // feed in pieces that split frames, never more than a quarter ring ahead of the slowest reader
+    std::thread feeder([&] {
+        int fd = ::open(fifo.c_str(), O_WRONLY);
+        std::vector<int32_t> all = stream(0, kPipeFrames);
+        const char* bytes = reinterpret_cast<const char*>(all.data());
+        size_t total = all.size() * sizeof(int32_t), sent = 0;
+        while (fd >= 0 && sent < total) {
+            uint64_t slowest = kPipeFrames;
+            for (const ReaderResult& r : results) slowest = std::min<uint64_t>(slowest, r.cursor);
+            if (sent / (kChannels * sizeof(int32_t)) > slowest + kCapacity / 4) {
+                std::this_thread::yield();
+                continue;
+            }
+            ssize_t n = ::write(fd, bytes + sent, std::min<size_t>(1001, total - sent));
+            if (n <= 0) break;
+            sent += (size_t)n;
+        }
+        if (fd >= 0) ::close(fd);
+    });
+
+    std::unique_ptr<CaptureSource> source = open_source(fifo, kChannels, kRate);
+    uint64_t captured = source ? capture(*source, writer) : 0;
+    feeder.join();
+    for (std::thread& t : readers) t.join();
+
+    std::printf("pipe     %llu frames through a %llu frame ring, %d readers\n",
+                (unsigned long long)captured, (unsigned long long)kCapacity, kReaders);
+    check(captured == kPipeFrames, "pipe source delivers every frame");
+    for (const ReaderResult& r : results) {
+        check(r.accepted == kPipeFrames, "pipe reader sees every frame");
+        check(r.bad == 0, "pipe reader frames match the stream");
+        check(r.out_of_order == 0, "pipe reader frames in order");
+        check(r.overruns == 0, "pipe reader kept up without an overrun");
+        check(r.meta_seen > 0 && r.meta_bad == 0, "pipe reader metadata whole and in order");
+    }
+}
+
+void test_file(const std::string& dir) {
+    std::string ring_path = dir + "/file.ring", file = dir + "/stream.raw";
+    std::vector<int32_t> all = stream(0, kFileFrames);
+    FILE* f = std::fopen(file.c_str(), "wb");
+    check(f && std::fwrite(all.data(), sizeof(int32_t), all.size(), f) == all.size(), "stream file written");
+    if (f) std::fclose(f);
+
+    RingWriter writer;
+    check(writer.create(ring_path, kChannels, kRate, kCapacity), "file ring created");
+    ReaderResult results[2];
+    std::thread fast(read_ring, ring_path, kFileFrames, 7u, 0, &results[0]);
+    std::thread slow(read_ring, ring_path, kFileFrames, 8u, 200, &results[1]);
+    std::unique_ptr<CaptureSource> source = open_source(file, kChannels, kRate);
+    uint64_t captured = source ? capture(*source, writer) : 0;
+    fast.join();
+    slow.join();
+
+    std::printf("file     %llu frames unpaced, readers accepted %llu and %llu frames, %llu and %llu overruns\n",
+                (unsigned long long)captured, (unsigned long long)results[0].accepted,
+                (unsigned long long)results[1].accepted, (unsigned long long)results[0].overruns,
+                (unsigned long long)results[1].overruns);
+    check(captured == kFileFrames, "file source delivers every frame");
+    for (const ReaderResult& r : results) {
+        check(r.bad == 0, "file reader never keeps a torn or overwritten view");
+        check(r.out_of_order == 0, "file reader frames in order");
+        check(r.meta_bad == 0, "file reader metadata whole and in order");
+    }
+}
+
+void test_overrun(const std::string& dir) {
+    const uint64_t cap = 64;
+    std::string path = dir + "/small.ring";
+    RingWriter writer;
+    check(writer.create(path, kChannels, kRate, cap), "small ring created");
+    RingReader reader;
+    check(reader.open(path), "small ring opens");
+    RingMetadata meta;
+    check(!reader.metadata(&meta), "no metadata before the first update");
+    writer.set_metadata(tag(5));
+    check(reader.metadata(&meta) && meta.frame == 5 && tag_ok(meta), "metadata read back");
+
+    // a whole ring behind while idle: view() counts the overrun and skips to the oldest frame
+    writer.write(stream(0, cap + 16).data(), cap + 16);
+    size_t n;
+    const int32_t* p = reader.view(cap, &n);
+    check(reader.overruns() == 1 && reader.cursor() == 16, "idle reader a ring behind is overrun to the oldest frame");
+    check(n == cap - 16 && frames_ok(p, 16, n), "view after the overrun is intact");
+    check(reader.release(n), "view after the overrun is released");
+
+    // lapped while holding a view
+    reader.seek_oldest();
+    p = reader.view(8, &n);
+    uint64_t at = reader.cursor();
+    check(n == 8 && frames_ok(p, at, n), "view before the writer laps it is intact");
+    writer.write(stream(cap + 16, cap).data(), cap);
+    check(!frames_ok(p, at, n), "lapped view now holds newer frames");
+    check(!reader.release(n) && reader.overruns() == 2, "release of a lapped view reports the overrun");
+    check(reader.cursor() == 2 * cap + 16 - cap, "lapped reader moved to the oldest intact frame");
+
+    // reserved but not yet committed: the writer may be part way through these slots
+    reader.seek_oldest();
+    p = reader.view(8, &n);
+    size_t room;
+    writer.acquire(8, &room);
+    check(!reader.release(n) && reader.overruns() == 3, "release of a view the writer has reserved is refused");
+    writer.commit(0);
+}
+
+void test_sharing(const std::string& dir) {
+    std::string path = dir + "/shared.ring";
+    RingWriter first;
+    check(first.create(path, kChannels, kRate, 64), "shared ring created");
+    RingWriter second;
+    errno = 0;
+    check(!second.create(path, kChannels, kRate, 64) && errno == EBUSY, "second writer refused while the first runs");
+    RingReader reader;
+    check(reader.open(path), "reader opens alongside the writer");
+    first.close();
+    errno = 0;
+    check(!second.create(path, kChannels, kRate, 64) && errno == EBUSY, "writer refused while a reader has the ring");
+    reader.close();
+    check(second.create(path, kChannels, kRate, 64), "writer recreates the ring once nobody has it");
+}
+
+void test_sources(const std::string& dir) {
+    std::string file = dir + "/partial.raw";
+    std::vector<int32_t> v = stream(0, 10);
+    v.push_back(sample(10, 0));                             // half of frame 10
+    FILE* f = std::fopen(file.c_str(), "wb");
+    if (f) {
+        std::fwrite(v.data(), sizeof(int32_t), v.size(), f);
+        std::fclose(f);
+    }
+    std::unique_ptr<CaptureSource> source = open_source(file, kChannels, kRate);
+    std::vector<int32_t> got(32 * kChannels);
+    long n = source ? source->read(got.data(), 32) : -1;
+    check(n == 10 && frames_ok(got.data(), 0, 10), "file source returns whole frames only");
+    check(source && source->read(got.data(), 32) == 0, "file source ends after the partial frame");
+    check(!open_source(dir + "/missing.raw", kChannels, kRate), "missing file does not open");
+
+    const uint8_t report[] = { 1, 0x34, 0x12, 0x86, 0x01, 0x03 };
+    SensorReport decoded;
+    check(HidPoller::decode_input(report, 6, &decoded) && decoded.temperature_centi_c == 0x1234 &&
+          decoded.mic_distance_mm == 390, "HID input report decodes");
+    const uint8_t other[] = { 4, 0, 0, 0, 0 };
+    check(!HidPoller::decode_input(other, 5, &decoded), "other HID reports are ignored");
+    check(!HidPoller::decode_input(report, 4, &decoded), "short HID reports are ignored");
+    HidPoller hid;
+    RingWriter ring;
+    check(!hid.start(file, 0, &ring), "HID poller refuses a file that is not a hidraw node");
+}
+
+}  // namespace
+
+int main() {
+    TempDir dir;
+    if (dir.path.empty()) {
+        std::printf("FAIL cannot make a temporary directory\n");
+        return 1;
+    }
+    test_pipe(dir.path);
+    test_file(dir.path);
+    test_overrun(dir.path);
+    test_sharing(dir.path);
+    test_sources(dir.path);
+
+    std::printf("%s\n", failures ? "FAIL" : "PASS");
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,24 @@
+#ifndef _MIC_GAIN_PROBE_H_
+#define _MIC_GAIN_PROBE_H_
+
+// The firmware's mic_gain.c is built twice for the host, once in each of
+// mic_gain_probe_c.c and mic_gain_probe_dsp.c with SAMPLE_CONVERT_DSP forced off
+// and on.  Each renames its globals so both versions link into sample_convert_test,
+// and exports the static scale() under the names below.
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// mic_gain.c's per sample gain, s * g / 2^14 saturated, as the M0+ C version and
+// as the M33 DSP version
+int32_t mic_gain_probe_scale_c(int32_t s, int32_t g);
+int32_t mic_gain_probe_scale_dsp(int32_t s, int32_t g);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,17 @@
+// mic_gain.c with SAMPLE_CONVERT_DSP forced off: the M0+ C version of scale().
+
+#undef SAMPLE_CONVERT_DSP
+#define SAMPLE_CONVERT_DSP 0                // the M0+ version, whatever the build says
+
+#define mic_mute mic_gain_probe_c_mute
+#define mic_volume mic_gain_probe_c_volume
+#define mic_gain_init mic_gain_probe_c_init
+#define mic_gain_changed mic_gain_probe_c_changed
+#define mic_gain_apply mic_gain_probe_c_apply
+
+#include "../../mic_gain.c"
+#include "mic_gain_probe.h"
+
+int32_t mic_gain_probe_scale_c(int32_t s, int32_t g) {
+    return scale(s, g);
+}
@@ -0,0 +1,17 @@
+// mic_gain.c with SAMPLE_CONVERT_DSP forced on: the M33 DSP version of scale().
+
+#undef SAMPLE_CONVERT_DSP
+#define SAMPLE_CONVERT_DSP 1                // the M33 version, on the intrinsics in test/shim
+
+#define mic_mute mic_gain_probe_dsp_mute
+#define mic_volume mic_gain_probe_dsp_volume
+#define mic_gain_init mic_gain_probe_dsp_init
+#define mic_gain_changed mic_gain_probe_dsp_changed
+#define mic_gain_apply mic_gain_probe_dsp_apply
+
+#include "../../mic_gain.c"
+#include "mic_gain_probe.h"
+
+int32_t mic_gain_probe_scale_dsp(int32_t s, int32_t g) {
+    return scale(s, g);
+}
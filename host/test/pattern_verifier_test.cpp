@@ -0,0 +1,269 @@
+/*
+Host test of the test pattern verifier (pattern_verifier.h).
+G. Whaley
+
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (C) 2025 The Whaley Group
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ *
+ */
+
+/*
+Each scenario builds a stream from test_pattern_fill() with known faults, writes it
+into a fifo in pieces that split frames, and checks it with PatternReader reading
+odd sized chunks through open_source(), as stream_verify does.  Every count must
+come out exact:
+
+    counter   silence before the first lock; a run across the 24 bit wrap, a
+              repeat and a drop across the wrap, a drop and a repeat; a block of
+              silence while locked; corrupt words, one followed by silence while
+              unlocked
+    sweep     a drop, a backward jump counted as a repeat, a drop of a whole
+              period plus 100 counted as 100, a forward jump of more than half
+              the period counted as a repeat of the rest, silence and a corrupt
+              word
+    held      a sweep relock with fewer than LOCK_FRAMES frames left is held
+              back, and counted once the next frames arrive
+    narrow    counter frames with the channel byte cut off, as 24 and 16 bit
+              builds send them, are reported; a whole counter stream is not
+
+Exits non-zero on any failure.
+*/
+
+#include "pattern_verifier.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace micarray;
+
+namespace {
+
+constexpr int kChannels = 2;
+constexpr uint32_t kRate = 48000;
+constexpr size_t kChunk = 97;                               // frames per read, so locks straddle reads
+constexpr uint64_t kWrap = 1u << 24;                        // counter frame numbers are 24 bits
+
+int failures = 0;
+
+void check(bool ok, const char* what) {
+    if (!ok) {
+        std::printf("FAIL %s\n", what);
+        failures++;
+    }
+}
+
+// a stream under construction and the counts the verifier should report for it
+struct Scenario {
+    int pattern;
+    std::vector<int32_t> words;
+    uint64_t next = 0;                                      // frame number after the last one added
+    VerifyStats want;
+
+    explicit Scenario(int p) : pattern(p) {}
+
+    // frames of the pattern starting at frame first, each expected to match
+    void run(uint64_t first, size_t frames) {
+        struct test_pattern gen;
+        test_pattern_start(&gen, pattern, kChannels, first);
+        size_t at = words.size();
+        words.resize(at + frames * kChannels);
+        test_pattern_fill(&gen, words.data() + at, (int)frames);
+        next = first + frames;
+        want.frames += frames;
+        want.matched += frames;
+    }
+
+    // silence in place of frames, the frame count carries on
+    void zeros(size_t frames) {
+        words.resize(words.size() + frames * kChannels, 0);
+        next += frames;
+        want.frames += frames;
+        want.silent += frames;
+    }
+
+    // the next frame with bits flipped in one word
+    void corrupt(int ch, uint32_t flip) {
+        run(next, 1);
+        words[words.size() - kChannels + ch] ^= (int32_t)flip;
+        want.matched--;
+        want.corrupt++;
+    }
+};
+
+struct TempDir {
+    std::string path;
+    TempDir() {
+        char name[] = "/tmp/micarray_verify_XXXXXX";
+        if (mkdtemp(name)) path = name;
+    }
+    ~TempDir() {
+        if (!path.empty()) std::filesystem::remove_all(path);
+    }
+};
+
+// the stream through a fifo in 1001 byte pieces, verified as stream_verify does
+VerifyStats verify_through_pipe(const std::string& dir, const Scenario& s, size_t* held,
+                                bool* channel_byte_missing = nullptr) {
+    std::string fifo = dir + "/stream.fifo";
+    ::unlink(fifo.c_str());
+    check(mkfifo(fifo.c_str(), 0600) == 0, "fifo created");
+    std::thread feeder([&] {
+        int fd = ::open(fifo.c_str(), O_WRONLY);
+        const char* bytes = reinterpret_cast<const char*>(s.words.data());
+        size_t total = s.words.size() * sizeof(int32_t), sent = 0;
+        while (fd >= 0 && sent < total) {
+            ssize_t n = ::write(fd, bytes + sent, std::min<size_t>(1001, total - sent));
+            if (n <= 0) break;
+            sent += (size_t)n;
+        }
+        if (fd >= 0) ::close(fd);
+    });
+
+    VerifyStats stats;
+    PatternVerifier verifier(s.pattern, kChannels);
+    PatternReader reader(kChannels, kChunk);
+    std::unique_ptr<CaptureSource> source = open_source(fifo, kChannels, kRate);
+    while (source && reader.read(source.get(), &verifier, &stats)) {}
+    feeder.join();
+    *held = reader.held();
+    if (channel_byte_missing) *channel_byte_missing = verifier.channel_byte_missing();
+    return stats;
+}
+
+void expect(const char* name, const VerifyStats& got, const VerifyStats& want, size_t held) {
+    std::printf("%-8s frames %llu  ok %llu  silent %llu  dropped %llu  repeated %llu  corrupt %llu  locks %llu\n", name,
+                (unsigned long long)got.frames, (unsigned long long)got.matched, (unsigned long long)got.silent,
+                (unsigned long long)got.dropped, (unsigned long long)got.repeated, (unsigned long long)got.corrupt,
+                (unsigned long long)got.locks);
+    char what[96];
+    const struct { const char* field; uint64_t got, want; } fields[] = {
+        { "frames", got.frames, want.frames }, { "matched", got.matched, want.matched },
+        { "silent", got.silent, want.silent }, { "dropped", got.dropped, want.dropped },
+        { "repeated", got.repeated, want.repeated }, { "corrupt", got.corrupt, want.corrupt },
+        { "locks", got.locks, want.locks },
+    };
+    for (const auto& f : fields) {
+        std::snprintf(what, sizeof(what), "%s %s %llu, expected %llu", name, f.field,
+                      (unsigned long long)f.got, (unsigned long long)f.want);
+        check(f.got == f.want, what);
+    }
+    std::snprintf(what, sizeof(what), "%s leaves no frames held back", name);
+    check(held == 0, what);
+}
+
+void test_counter(const std::string& dir) {
+    Scenario s(TEST_PATTERN_COUNTER);
+    s.zeros(100);                                           // before any lock, no frame count yet
+    s.run(kWrap - 700, 1000);                               // across the wrap
+    s.run(s.next - 310, 5);                                 // back across the wrap
+    s.want.repeated += 310;
+    s.run(s.next + 8, 500);                                 // forward across it again
+    s.want.dropped += 8;
+    s.run(s.next + 37, 500);
+    s.want.dropped += 37;
+    s.run(s.next - 12, 500);
+    s.want.repeated += 12;
+    s.zeros(480);                                           // a block of silence while locked
+    s.run(s.next, 400);
+    s.corrupt(1, 0x100);                                    // frame number of one channel
+    s.zeros(20);                                            // silence while unlocked keeps the count
+    s.run(s.next, 300);
+    s.corrupt(0, 0x01);                                     // channel byte
+    s.run(s.next, 300);
+    s.want.locks = 7;
+    size_t held;
+    expect("counter", verify_through_pipe(dir, s, &held), s.want, held);
+}
+
+void test_sweep(const std::string& dir) {
+    Scenario s(TEST_PATTERN_SWEEP);
+    s.run(1000, 2000);
+    s.run(s.next + 100, 1000);
+    s.want.dropped += 100;
+    s.run(s.next - 300, 1000);                              // backward, a repeat rather than 47700 drops
+    s.want.repeated += 300;
+    s.run(s.next + TEST_PATTERN_SWEEP_FRAMES + 100, 1000);  // only known modulo the period
+    s.want.dropped += 100;
+    s.run(s.next + 30000, 1000);                            // more than half forward reads as going back
+    s.want.repeated += TEST_PATTERN_SWEEP_FRAMES - 30000;
+    s.zeros(480);
+    s.run(s.next, 500);
+    s.corrupt(0, 0x100);
+    s.zeros(20);
+    s.run(s.next, 500);
+    s.want.locks = 6;
+    size_t held;
+    expect("sweep", verify_through_pipe(dir, s, &held), s.want, held);
+}
+
+void test_held() {
+    Scenario s(TEST_PATTERN_SWEEP);
+    s.run(5000, 100);
+    s.run(s.next + 40, 100);
+    PatternVerifier verifier(TEST_PATTERN_SWEEP, kChannels);
+    VerifyStats stats;
+    const size_t jump_at = 100, first = jump_at + PatternVerifier::LOCK_FRAMES - 1;
+    size_t used = verifier.process(s.words.data(), first, &stats);
+    check(used == jump_at, "sweep relock with too few frames stops at the jump");
+    size_t rest = verifier.process(s.words.data() + used * kChannels, 200 - used, &stats);
+    check(rest == 200 - used, "the held frames and the rest are all consumed");
+    check(stats.matched == 200 && stats.dropped == 40 && stats.locks == 2, "held frames counted once, after the lock");
+}
+
+void test_narrow(const std::string& dir) {
+    Scenario s(TEST_PATTERN_COUNTER);
+    s.run(1000, 2000);
+    size_t held;
+    bool missing = true;
+    verify_through_pipe(dir, s, &held, &missing);
+    check(!missing, "a whole counter stream has its channel byte");
+
+    for (int32_t& w : s.words) w &= (int32_t)0xFFFFFF00;    // 24 bit samples widened again by the host
+    VerifyStats stats = verify_through_pipe(dir, s, &held, &missing);
+    check(missing, "counter frames without the channel byte are reported");
+    check(stats.locks == 0, "counter frames without the channel byte never lock");
+}
+
+}  // namespace
+
+int main() {
+    TempDir dir;
+    check(!dir.path.empty(), "temporary directory created");
+    if (dir.path.empty()) return 1;
+    test_counter(dir.path);
+    test_sweep(dir.path);
+    test_held();
+    test_narrow(dir.path);
+
+    std::printf("pattern_verifier: %s\n", failures ? "FAIL" : "PASS");
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,250 @@
+/*
+Host test of the per sample conversion kernels (sample_convert.c).
+G. Whaley
+
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (C) 2025 The Whaley Group
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ *
+ */
+
+/*
+The input is the saturation and rounding edges (INT32_MIN, INT32_MAX, 0x7FFF8000,
+0 and their neighbours), each in every position of a 4 sample group and of a frame,
+followed by random words.  Every check is exact:
+
+    _c        each kernel against a reference written from its definition in
+              sample_convert.h, in 64 bit arithmetic
+    _interp   each kernel bit for bit against its _c version, run on the model of
+              the interpolator in soak/shim/hardware/interp.h, and the interpolator
+              state a kernel finds is the state it leaves
+    _dsp      convert_to_s16_dsp, and the gain of mic_gain.c, bit for bit against
+              their C versions, on the QADD and SSAT of test/shim/arm_acle.h; the
+              gain over the same samples with random Q14 gains, and every edge
+              sample against the gain edges 0, 1, unity, +12 dB and 65535
+
+The build runs it once for each MIC_SAMPLE_BITS in host/CMakeLists.txt.  Exits
+non-zero on any failure.
+*/
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <vector>
+
+extern "C" {
+#include "hardware/interp.h"
+#include "mic_gain.h"
+#include "mic_gain_probe.h"
+#include "sample_convert.h"
+
+interp_hw_t soak_interp0, soak_interp1;
+}
+
+namespace {
+
+constexpr int kSamples = 1 << 20;                           // a multiple of 4 and of MIC_CHANNELS
+constexpr int kFrames = kSamples / MIC_CHANNELS;
+constexpr int32_t kGainEdges[] = { 0, 1, MIC_GAIN_UNITY - 1, MIC_GAIN_UNITY, MIC_GAIN_UNITY + 1, 65226, 65535 };
+constexpr int32_t kEdges[] = {
+    INT32_MIN, INT32_MIN + 1, INT32_MAX, INT32_MAX - 1, (int32_t)0x7FFF8000, (int32_t)0x7FFF7FFF,
+    0, -1, 1, 0x8000, -0x8000, 0x7FFF, -0x8001,
+};
+
+int failures = 0;
+
+void check(bool ok, const char* what) {
+    if (!ok) {
+        std::printf("FAIL %s\n", what);
+        failures++;
+    }
+}
+
+std::vector<int32_t> make_input() {
+    const int edges = sizeof(kEdges) / sizeof(kEdges[0]);  // odd, so each edge lands on every slot of 4
+    std::vector<int32_t> src(kSamples);
+    std::mt19937 rng(1);
+    int i = 0;
+    for (; i < 4 * MIC_CHANNELS * edges; i++) src[i] = kEdges[i % edges];
+    for (; i < kSamples; i++) src[i] = (int32_t)rng();
+    return src;
+}
+
+// ---- references, from the definitions in sample_convert.h
+
+int32_t ref_normalize(int32_t x) {
+    return (int32_t)((uint32_t)x & (0xFFFFFFFFu << (32 - MIC_SAMPLE_BITS)));
+}
+
+int16_t ref_s16(int32_t x) {
+    int64_t v = ref_normalize(x);
+    int64_t r = (v + 32768) >> 16;                          // round half up
+    return (int16_t)(r > 32767 ? 32767 : r);
+}
+
+void ref_s24(uint8_t* out, int32_t x) {
+    uint32_t v = (uint32_t)ref_normalize(x);
+    out[0] = (uint8_t)(v >> 8);
+    out[1] = (uint8_t)(v >> 16);
+    out[2] = (uint8_t)(v >> 24);
+}
+
+template <typename T>
+bool same(const std::vector<T>& a, const std::vector<T>& b) {
+    return a.size() == b.size() && std::memcmp(a.data(), b.data(), a.size() * sizeof(T)) == 0;
+}
+
+// a state no kernel would set, restored by every _interp kernel
+void interp_scramble(uint32_t seed) {
+    interp_hw_t* interps[2] = { interp0, interp1 };
+    for (interp_hw_t* interp : interps) {
+        for (int i = 0; i < 2; i++) {
+            interp->accum[i] = seed++ * 0x9E3779B9u;
+            interp->ctrl[i] = (seed++ * 0x85EBCA6Bu) & 0x001FFFFFu;
+        }
+        for (int i = 0; i < 3; i++) interp->base[i] = seed++ * 0xC2B2AE35u;
+    }
+}
+
+bool interp_unchanged(uint32_t seed) {
+    interp_hw_t want[2], got[2] = { *interp0, *interp1 };
+    interp_scramble(seed);
+    want[0] = *interp0;
+    want[1] = *interp1;
+    *interp0 = got[0];
+    *interp1 = got[1];
+    return std::memcmp(want, got, sizeof(want)) == 0;
+}
+
+void test_normalize(const std::vector<int32_t>& src) {
+    std::vector<int32_t> want(kSamples), c(kSamples), interp(kSamples);
+    for (int i = 0; i < kSamples; i++) want[i] = ref_normalize(src[i]);
+    convert_normalize_c(c.data(), src.data(), kSamples);
+    interp_scramble(1);
+    convert_normalize_interp(interp.data(), src.data(), kSamples);
+    check(same(c, want), "normalize_c matches the reference");
+    check(same(interp, c), "normalize_interp matches normalize_c");
+    check(interp_unchanged(1), "normalize_interp restores interp0");
+}
+
+void test_to_s16(const std::vector<int32_t>& src) {
+    std::vector<int16_t> want(kSamples), c(kSamples), interp(kSamples);
+    for (int i = 0; i < kSamples; i++) want[i] = ref_s16(src[i]);
+    convert_to_s16_c(c.data(), src.data(), kSamples);
+    interp_scramble(2);
+    convert_to_s16_interp(interp.data(), src.data(), kSamples);
+    check(same(c, want), "to_s16_c matches the reference");
+    check(same(interp, c), "to_s16_interp matches to_s16_c");
+    check(interp_unchanged(2), "to_s16_interp restores interp1");
+
+    std::vector<int16_t> dsp(kSamples), dsp_odd(kSamples - 1);
+    convert_to_s16_dsp(dsp.data(), src.data(), kSamples);
+    convert_to_s16_dsp(dsp_odd.data(), src.data(), kSamples - 1);    // the unpaired last sample
+    check(same(dsp, c), "to_s16_dsp matches to_s16_c");
+    check(same(dsp_odd, std::vector<int16_t>(c.begin(), c.end() - 1)), "to_s16_dsp of an odd count matches to_s16_c");
+}
+
+void test_gain(const std::vector<int32_t>& src) {
+    std::mt19937 rng(2);
+    bool random_ok = true, edges_ok = true;
+    for (int i = 0; i < kSamples; i++) {
+        int32_t s = ref_normalize(src[i]), g = (int32_t)(rng() & 0xFFFF);
+        random_ok = random_ok && mic_gain_probe_scale_dsp(s, g) == mic_gain_probe_scale_c(s, g);
+    }
+    for (int32_t x : kEdges) {
+        for (int32_t g : kGainEdges) {
+            int32_t s = ref_normalize(x);
+            edges_ok = edges_ok && mic_gain_probe_scale_dsp(s, g) == mic_gain_probe_scale_c(s, g);
+        }
+    }
+    check(random_ok, "gain dsp matches gain c on random samples and gains");
+    check(edges_ok, "gain dsp matches gain c on the sample and gain edges");
+}
+
+void test_to_s24(const std::vector<int32_t>& src) {
+    std::vector<uint32_t> want(kSamples * 3 / 4), c(kSamples * 3 / 4), interp(kSamples * 3 / 4);    // word aligned
+    for (int i = 0; i < kSamples; i++) ref_s24(reinterpret_cast<uint8_t*>(want.data()) + 3 * i, src[i]);
+    convert_to_s24_c(reinterpret_cast<uint8_t*>(c.data()), src.data(), kSamples);
+    interp_scramble(3);
+    convert_to_s24_interp(reinterpret_cast<uint8_t*>(interp.data()), src.data(), kSamples);
+    check(same(c, want), "to_s24_c matches the reference");
+    check(same(interp, c), "to_s24_interp matches to_s24_c");
+    check(interp_unchanged(3), "to_s24_interp restores interp0 and interp1");
+}
+
+void test_planar(const std::vector<int32_t>& src) {
+    std::vector<int32_t> want[MIC_CHANNELS], c[MIC_CHANNELS], interp[MIC_CHANNELS];
+    int32_t* c_out[MIC_CHANNELS];
+    int32_t* interp_out[MIC_CHANNELS];
+    for (int ch = 0; ch < MIC_CHANNELS; ch++) {
+        want[ch].resize(kFrames);
+        c[ch].resize(kFrames);
+        interp[ch].resize(kFrames);
+        for (int i = 0; i < kFrames; i++) want[ch][i] = ref_normalize(src[i * MIC_CHANNELS + ch]);
+        c_out[ch] = c[ch].data();
+        interp_out[ch] = interp[ch].data();
+    }
+    convert_deinterleave_c(c_out, src.data(), kFrames);
+    interp_scramble(4);
+    convert_deinterleave_interp(interp_out, src.data(), kFrames);
+    bool c_ok = true, interp_ok = true;
+    for (int ch = 0; ch < MIC_CHANNELS; ch++) {
+        c_ok = c_ok && same(c[ch], want[ch]);
+        interp_ok = interp_ok && same(interp[ch], c[ch]);
+    }
+    check(c_ok, "deinterleave_c matches the reference");
+    check(interp_ok, "deinterleave_interp matches deinterleave_c");
+    check(interp_unchanged(4), "deinterleave_interp restores interp0");
+
+    // back again, from the raw words so the mask is exercised
+    const int32_t* planar[MIC_CHANNELS];
+    std::vector<int32_t> raw[MIC_CHANNELS];
+    for (int ch = 0; ch < MIC_CHANNELS; ch++) {
+        raw[ch].resize(kFrames);
+        for (int i = 0; i < kFrames; i++) raw[ch][i] = src[i * MIC_CHANNELS + ch];
+        planar[ch] = raw[ch].data();
+    }
+    std::vector<int32_t> want_il(kSamples), c_il(kSamples), interp_il(kSamples);
+    for (int i = 0; i < kSamples; i++) want_il[i] = ref_normalize(src[i]);
+    convert_interleave_c(c_il.data(), planar, kFrames);
+    interp_scramble(5);
+    convert_interleave_interp(interp_il.data(), planar, kFrames);
+    check(same(c_il, want_il), "interleave_c matches the reference");
+    check(same(interp_il, c_il), "interleave_interp matches interleave_c");
+    check(interp_unchanged(5), "interleave_interp restores interp0");
+}
+
+}  // namespace
+
+int main() {
+    std::vector<int32_t> src = make_input();
+    test_normalize(src);
+    test_to_s16(src);
+    test_gain(src);
+    test_to_s24(src);
+    test_planar(src);
+
+    std::printf("sample_convert %d bit samples, %d words: %s\n", MIC_SAMPLE_BITS, kSamples, failures ? "FAIL" : "PASS");
+    return failures ? 1 : 0;
+}
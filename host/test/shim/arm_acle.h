@@ -0,0 +1,21 @@
+#ifndef _TEST_ARM_ACLE_H_
+#define _TEST_ARM_ACLE_H_
+
+// The Cortex-M33 DSP intrinsics the firmware uses, in plain C with the saturation
+// the ACLE defines, so the SAMPLE_CONVERT_DSP code builds and runs on the host.
+
+#include <stdint.h>
+
+// QADD: a + b saturated to int32
+static inline int32_t __qadd(int32_t a, int32_t b) {
+    int64_t r = (int64_t)a + b;
+    return r > INT32_MAX ? INT32_MAX : r < INT32_MIN ? INT32_MIN : (int32_t)r;
+}
+
+// SSAT: x saturated to a signed value of bits (1 to 32) bits
+static inline int32_t __ssat(int32_t x, unsigned bits) {
+    int64_t hi = ((int64_t)1 << (bits - 1)) - 1, lo = -((int64_t)1 << (bits - 1));
+    return x > hi ? (int32_t)hi : x < lo ? (int32_t)lo : x;
+}
+
+#endif
@@ -0,0 +1,33 @@
+// The firmware's spectrum.c built for the host against the shim headers, with
+// access to its fixed point transform and band tables for spectrum_test.cpp.
+
+#include "../../spectrum.c"
+
+#include "spectrum_probe.h"
+
+systick_hw_t soak_systick;
+
+const int spectrum_probe_fft_size = FFT_N;
+const int spectrum_probe_bands = SPECTRUM_BANDS;
+
+// Transform one frame of 24 bit samples and write the separated bin powers of each
+// channel, in input lsbs squared, for bins 0 to FFT_N / 2.  Bin 0 is not separable
+// and is left at zero.  Uses the same buffers as spectrum_add_block().
+void spectrum_probe_bins(const int32_t* left, const int32_t* right, double* power_l, double* power_r) {
+    memcpy(input[0], left, sizeof(input[0]));
+    memcpy(input[1], right, sizeof(input[1]));
+    double unit = ldexp(1.0, 2 * transform_input());
+    power_l[0] = power_r[0] = 0;
+    for (int k = 1; k <= FFT_N / 2; k++) {
+        uint32_t l, r;
+        separate_bin(k, &l, &r);
+        power_l[k] = l * unit;
+        power_r[k] = r * unit;
+    }
+    spectrum_reset();
+}
+
+void spectrum_probe_band(int b, int* lo, int* hi) {
+    *lo = band_lo[b];
+    *hi = band_hi[b];
+}
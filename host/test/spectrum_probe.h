@@ -0,0 +1,20 @@
+#ifndef _SPECTRUM_PROBE_H_
+#define _SPECTRUM_PROBE_H_
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+extern const int spectrum_probe_fft_size;
+extern const int spectrum_probe_bands;
+
+void spectrum_probe_bins(const int32_t* left, const int32_t* right, double* power_l, double* power_r);
+void spectrum_probe_band(int b, int* lo, int* hi);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,247 @@
+/*
+Host test of the firmware band spectrum (spectrum.c) against a double precision DFT.
+G. Whaley
+
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (C) 2025 The Whaley Group
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ *
+ */
+
+/*
+The fixed point FFT packs left and right into one complex transform, runs block
+floating point in 16 bits and separates the channels afterwards.  The reference
+here windows each channel with an exact Hann window and takes its DFT in double.
+
+Both channels share one block exponent, so the transform's noise floor sits a
+fixed distance below the louder channel, and the limits are taken relative to the
+whole frame:
+
+    bins    every separated bin power of a frame, for two tones at different levels
+            on the two channels, one tone with the other channel silent, and
+            independent noise.  A bin within BIN_STRONG_DB of the frame's largest
+            bin must agree to BIN_STRONG_TOL_DB.  In every bin the power of the
+            magnitude error must be BIN_FLOOR_DB below the frame's total power, so
+            a tone on one channel does not show on the other above that floor.
+    bands   the levels of a published report, tones plus noise through
+            spectrum_add_block(), against the reference band levels over the same
+            frames, in the report's 0.5 dB steps.  Bands within BAND_STRONG_DB of the
+            loudest band must agree to BAND_STRONG_TOL steps, those within
+            BAND_RANGE_DB to BAND_WEAK_TOL steps.  Quieter bands are at the floor:
+            they may read louder than the reference but not quieter, and must
+            still read BAND_RANGE_DB below the loudest band.
+
+Exits non-zero on any failure.
+*/
+
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+extern "C" {
+#include "spectrum.h"
+#include "spectrum_probe.h"
+}
+
+namespace {
+
+constexpr double kPi = 3.14159265358979323846;
+constexpr double kFullScale = 8388608.0;                   // 24 bit
+
+constexpr double BIN_STRONG_DB = 30.0;
+constexpr double BIN_STRONG_TOL_DB = 0.2;
+constexpr double BIN_FLOOR_DB = 72.0;
+constexpr int BAND_STRONG_DB = 50;
+constexpr int BAND_RANGE_DB = 56;
+constexpr int BAND_STRONG_TOL = 1;                          // 0.5 dB
+constexpr int BAND_WEAK_TOL = 3;                            // 1.5 dB
+
+int failures = 0;
+
+void check(bool ok, const char* what) {
+    if (!ok) {
+        std::printf("FAIL %s\n", what);
+        failures++;
+    }
+}
+
+struct Tone {
+    double hz;
+    double amplitude;                                       // 1.0 = full scale
+};
+
+// one channel of 24 bit samples: tones plus white noise of the given rms
+std::vector<int32_t> make_signal(size_t frames, std::vector<Tone> tones, double noise_rms, std::mt19937& rng) {
+    std::normal_distribution<double> noise(0.0, noise_rms);
+    std::vector<int32_t> out(frames);
+    for (size_t n = 0; n < frames; n++) {
+        double v = noise_rms > 0 ? noise(rng) : 0.0;
+        for (const Tone& t : tones) v += t.amplitude * std::sin(2 * kPi * t.hz * n / MIC_SAMPLE_RATE + 0.3);
+        v = std::max(-1.0, std::min(v, 1.0 - 1.0 / kFullScale));
+        out[n] = (int32_t)std::lround(v * kFullScale);
+    }
+    return out;
+}
+
+// |DFT|^2 of one Hann windowed frame, bins 0 to N / 2
+std::vector<double> reference_bins(const int32_t* x, int n) {
+    std::vector<double> w(n);
+    for (int i = 0; i < n; i++) w[i] = 0.5 - 0.5 * std::cos(2 * kPi * i / n);
+    std::vector<double> power(n / 2 + 1);
+    for (int k = 0; k <= n / 2; k++) {
+        std::complex<double> sum = 0;
+        for (int i = 0; i < n; i++) sum += w[i] * x[i] * std::polar(1.0, -2 * kPi * (double)k * i / n);
+        power[k] = std::norm(sum);
+    }
+    return power;
+}
+
+double db(double p) {
+    return 10 * std::log10(std::max(p, 1e-300));
+}
+
+void check_bins(const char* name, const std::vector<int32_t>& left, const std::vector<int32_t>& right) {
+    const int n = spectrum_probe_fft_size;
+    std::vector<double> fixed[2] = { std::vector<double>(n / 2 + 1), std::vector<double>(n / 2 + 1) };
+    spectrum_probe_bins(left.data(), right.data(), fixed[0].data(), fixed[1].data());
+    std::vector<double> refs[2] = { reference_bins(left.data(), n), reference_bins(right.data(), n) };
+    double top = 0, total = 0;
+    for (int ch = 0; ch < 2; ch++) {
+        top = std::max(top, *std::max_element(refs[ch].begin() + 1, refs[ch].end()));
+        for (int k = 1; k <= n / 2; k++) total += refs[ch][k];
+    }
+
+    for (int ch = 0; ch < 2; ch++) {
+        const std::vector<double>& ref = refs[ch];
+        double worst_strong = 0, worst_floor = -999;
+        for (int k = 1; k <= n / 2; k++) {
+            double err = std::pow(std::sqrt(fixed[ch][k]) - std::sqrt(ref[k]), 2);    // power of the magnitude error
+            if (ref[k] >= top * std::pow(10, -BIN_STRONG_DB / 10)) {
+                worst_strong = std::max(worst_strong, std::fabs(db(fixed[ch][k]) - db(ref[k])));
+            }
+            worst_floor = std::max(worst_floor, db(err) - db(total));
+        }
+        std::printf("bins  %-9s %s  strong bins within %.3f dB, worst error %.1f dB below the frame power\n",
+                    name, ch ? "right" : "left ", worst_strong, -worst_floor);
+        char what[96];
+        std::snprintf(what, sizeof(what), "%s %s strong bins within %.2f dB", name, ch ? "right" : "left", BIN_STRONG_TOL_DB);
+        check(worst_strong <= BIN_STRONG_TOL_DB, what);
+        std::snprintf(what, sizeof(what), "%s %s error floor %.0f dB below the frame power", name, ch ? "right" : "left", BIN_FLOOR_DB);
+        check(-worst_floor >= BIN_FLOOR_DB, what);
+    }
+}
+
+// a reference report level, in the firmware's 0.5 dB steps below a full scale sine
+int reference_level(double power) {
+    double below = power > 0 ? -20 * std::log10(power) : 255.0;
+    return (int)std::lround(std::max(0.0, std::min(below, 255.0)));
+}
+
+void check_bands() {
+    const int n = spectrum_probe_fft_size;
+    const int bands = spectrum_probe_bands;
+    const uint16_t interval_ms = 100;
+    const size_t frames = (size_t)interval_ms * MIC_SAMPLE_RATE / 1000;
+    std::mt19937 rng(7);
+    std::vector<int32_t> x[2] = {
+        make_signal(frames, { { 1000.0, 0.3 }, { 6300.0, 0.01 } }, 1e-3, rng),
+        make_signal(frames, { { 250.0, 0.03 } }, 1e-4, rng),
+    };
+
+    spectrum_init();
+    spectrum_interval_ms = interval_ms;
+    std::vector<int> block(frames * MIC_CHANNELS);
+    for (size_t i = 0; i < frames; i++) {
+        block[i * MIC_CHANNELS] = x[0][i] * 256;               // as the mics deliver it, in bits 31-8
+        block[i * MIC_CHANNELS + 1] = x[1][i] * 256;
+    }
+    const int block_frames = MIC_BLOCK_FRAMES;
+    for (size_t i = 0; i < frames; i += block_frames) {
+        spectrum_add_block(reinterpret_cast<const int (*)[MIC_CHANNELS]>(&block[i * MIC_CHANNELS]), block_frames);
+    }
+    uint8_t report[SPECTRUM_REPORT_LEN];
+    check(spectrum_take_report(report), "bands report published after one interval");
+
+    // the firmware takes an FFT every n / 2 frames once the first n have arrived
+    double window_power = 0;
+    for (int i = 0; i < n; i++) window_power += std::pow(0.5 - 0.5 * std::cos(2 * kPi * i / n), 2);
+    window_power /= n;
+    double scale = 4.0 / ((double)n * n * window_power) / (kFullScale * kFullScale);
+    int want[2][SPECTRUM_BANDS];
+    for (int ch = 0; ch < 2; ch++) {
+        std::vector<double> power(bands, 0.0);
+        int ffts = 0;
+        for (size_t start = 0; start + n <= frames; start += n / 2, ffts++) {
+            std::vector<double> ref = reference_bins(&x[ch][start], n);
+            for (int b = 0; b < bands; b++) {
+                int lo, hi;
+                spectrum_probe_band(b, &lo, &hi);
+                for (int k = lo; k <= hi; k++) power[b] += ref[k];
+            }
+        }
+        for (int b = 0; b < bands; b++) want[ch][b] = reference_level(power[b] / ffts * scale);
+    }
+
+    int loudest = 255;
+    for (int ch = 0; ch < 2; ch++) loudest = std::min(loudest, *std::min_element(want[ch], want[ch] + bands));
+    int worst_strong = 0, worst_weak = 0, floor_quieter = 0, floor_loudest = 255;
+    for (int ch = 0; ch < 2; ch++) {
+        for (int b = 0; b < bands; b++) {
+            int got = report[1 + ch * bands + b];
+            int below = want[ch][b] - loudest;                  // steps below the loudest band
+            if (below <= 2 * BAND_STRONG_DB) {
+                worst_strong = std::max(worst_strong, std::abs(got - want[ch][b]));
+            } else if (below <= 2 * BAND_RANGE_DB) {
+                worst_weak = std::max(worst_weak, std::abs(got - want[ch][b]));
+            } else {
+                floor_quieter = std::max(floor_quieter, got - want[ch][b]);
+                floor_loudest = std::min(floor_loudest, got - loudest);
+            }
+        }
+    }
+    std::printf("bands strong bands within %d, weaker within %d steps of 0.5 dB, floor bands at least %.1f dB down\n",
+                worst_strong, worst_weak, floor_loudest / 2.0);
+    check(worst_strong <= BAND_STRONG_TOL, "bands within BAND_STRONG_DB of the loudest agree to BAND_STRONG_TOL");
+    check(worst_weak <= BAND_WEAK_TOL, "bands within BAND_RANGE_DB of the loudest agree to BAND_WEAK_TOL");
+    check(floor_quieter <= BAND_STRONG_TOL, "bands at the floor do not read quieter than the reference");
+    check(floor_loudest >= 2 * BAND_RANGE_DB, "bands at the floor read BAND_RANGE_DB below the loudest");
+}
+
+}  // namespace
+
+int main() {
+    spectrum_init();
+    const int n = spectrum_probe_fft_size;
+    std::mt19937 rng(1);
+
+    check_bins("tones", make_signal(n, { { 1000.7, 0.5 } }, 0, rng), make_signal(n, { { 3517.0, 0.1 } }, 0, rng));
+    check_bins("one side", make_signal(n, { { 440.0, 0.9 } }, 0, rng), make_signal(n, {}, 0, rng));
+    check_bins("noise", make_signal(n, {}, 0.1, rng), make_signal(n, {}, 0.01, rng));
+    check_bands();
+
+    std::printf("%s\n", failures ? "FAIL" : "PASS");
+    return failures ? 1 : 0;
+}
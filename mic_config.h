@@ -0,0 +1,138 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (C) 2025 The Whaley Group
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+/*
+Audio format and microphone wiring, in one place.
+
+Everything else is derived from the values below: the USB audio descriptors and
+endpoint size (tusb_config.h), the sample ring and dma transfer count, the PIO
+clock, the block byte counts and the sample rate reported to the host.  Each
+value can be overridden from the build, e.g. -DMIC_BLOCK_FRAMES=96, and the
+checks at the end stop a combination the hardware or the code cannot handle.
+
+MIC_CHANNELS is followed by the USB descriptors (channel cluster and feature unit,
+1 to 16 channels), the mute and volume controls, the sample ring, the conversion
+kernels and the activity detector.  The capture itself is not: the I2S program
+reads one stereo data line, and the spectrum packs one stereo pair per FFT, so any
+other channel count stops the build in stereo_mic_i2s.c and spectrum.h until a
+capture program for more microphones (TDM or several data pins) is added.
+
+This file is also included by tusb_config.h, so it only uses the preprocessor.
+*/
+
+#ifndef _MIC_CONFIG_H_
+#define _MIC_CONFIG_H_
+
+#ifndef MIC_CHANNELS
+#define MIC_CHANNELS 2                      // microphones, interleaved in every frame
+#endif
+
+#ifndef MIC_SAMPLE_RATE
+#define MIC_SAMPLE_RATE 48000               // Hz
+#endif
+
+#ifndef MIC_SAMPLE_BITS
+#define MIC_SAMPLE_BITS 24                  // valid bits from each microphone, msb aligned in the word
+#endif
+
+#ifndef MIC_BYTES_PER_SAMPLE
+#define MIC_BYTES_PER_SAMPLE 4              // USB subslot size: 4 = SE_32, 3 = packed 24 bit, 2 = 16 bit rounded
+#endif
+
+#ifndef MIC_SLOT_BITS
+#define MIC_SLOT_BITS 32                    // I2S bit clocks per channel slot
+#endif
+
+#ifndef MIC_BLOCK_FRAMES
+#define MIC_BLOCK_FRAMES (MIC_SAMPLE_RATE / 1000)   // frames per dma block, 1 ms matches the USB frame
+#endif
+
+#ifndef MIC_PIO
+#define MIC_PIO pio0                        // PIO block running the I2S program, pio0-pio1 (RP2040) or pio0-pio2 (RP2350)
+#endif
+
+#ifndef MIC_PIO_SM
+#define MIC_PIO_SM 0                        // state machine within MIC_PIO
+#endif
+
+#ifndef MIC_GPIO_DATA
+#define MIC_GPIO_DATA 2                     // I2S DAT input
+#endif
+
+#ifndef MIC_GPIO_CLK
+#define MIC_GPIO_CLK 3                      // BCLK, LRCLK is the next pin
+#endif
+
+// derived values
+#define MIC_BLOCK_SAMPLES (MIC_BLOCK_FRAMES * MIC_CHANNELS)
+#define MIC_BLOCK_BYTES (MIC_BLOCK_SAMPLES * MIC_BYTES_PER_SAMPLE)
+#define MIC_FRAMES_PER_MS (MIC_SAMPLE_RATE / 1000)
+#define MIC_BCLK_HZ (MIC_SAMPLE_RATE * MIC_SLOT_BITS * 2)          // I2S frame is two slots, left and right
+#define MIC_PIO_CLK_HZ (MIC_BCLK_HZ * 2)                            // the program takes two instructions per bit clock
+
+// Leading bits of each sample word the USB format carries.  SE_32 sends the word as
+// it is; the narrower formats keep at most the sample bits, which the 16 bit one
+// also rounds.
+#if MIC_BYTES_PER_SAMPLE == 4
+#define MIC_WIRE_BITS 32
+#elif MIC_SAMPLE_BITS < MIC_BYTES_PER_SAMPLE * 8
+#define MIC_WIRE_BITS MIC_SAMPLE_BITS
+#else
+#define MIC_WIRE_BITS (MIC_BYTES_PER_SAMPLE * 8)
+#endif
+
+// Largest isochronous packet: one millisecond of frames plus one, so the driver can
+// send an extra frame when the host and device clocks drift apart.
+#define MIC_EP_SIZE_IN ((MIC_FRAMES_PER_MS + 1) * MIC_BYTES_PER_SAMPLE * MIC_CHANNELS)
+
+#if MIC_SAMPLE_RATE % 1000 != 0
+#error "MIC_SAMPLE_RATE must be a whole number of frames per 1 ms USB frame"
+#endif
+
+#if MIC_SLOT_BITS != 32
+#error "the I2S program clocks 32 bit slots"
+#endif
+
+#if MIC_BYTES_PER_SAMPLE < 2 || MIC_BYTES_PER_SAMPLE > 4
+#error "MIC_BYTES_PER_SAMPLE must be 2, 3 or 4"
+#endif
+
+#if MIC_BYTES_PER_SAMPLE == 3 && (MIC_BLOCK_FRAMES * MIC_CHANNELS) % 4 != 0
+#error "packed 24 bit blocks must hold a multiple of 4 samples"
+#endif
+
+#if MIC_SAMPLE_BITS < 8 || MIC_SAMPLE_BITS > MIC_SLOT_BITS
+#error "MIC_SAMPLE_BITS does not fit the slot"
+#endif
+
+#if MIC_BLOCK_FRAMES < 1 || MIC_BLOCK_FRAMES > 2 * MIC_FRAMES_PER_MS
+#error "MIC_BLOCK_FRAMES must be between 1 frame and 2 ms so two blocks fit the USB fifo"
+#endif
+
+#if MIC_PIO_SM > 3
+#error "MIC_PIO_SM must be 0 to 3"
+#endif
+
+#endif
@@ -0,0 +1,142 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (C) 2025 The Whaley Group
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+/*
+Per channel gain of the feature unit, applied to each block on its way to USB.
+
+The gain of a channel is the sum of the master and channel volume controls in dB,
+or zero when either is muted or at -infinity, held as an unsigned Q14 factor from 0
+to 65535 (+12 dB is 65226).  The M0+ only has a 32 bit multiply, so each sample is
+split into its top 16 bits and its next 8 bits (the bits below the 24 bit sample
+are zero) and the two partial products are added, which is exact to 2 bits below
+the sample lsb.  The result is scaled back
+to SE_32 with saturation at full scale.  The M33 (SAMPLE_CONVERT_DSP) does the
+whole product in one SMULL and the saturation in one SSAT, with the same result
+for samples of up to 24 bits.
+
+A change of control starts a linear ramp of MIC_GAIN_RAMP_MS from the gain in use
+to the new one, so mute, unmute and volume steps do not click.  At unity the block
+is not touched at all, and a channel at zero gain is simply cleared.
+
+The ring and the activity detector and spectrum keep the unscaled samples; only
+the stream sent to the host is affected.
+*/
+
+#include <math.h>
+#include "mic_gain.h"
+#include "sample_convert.h"
+
+#if SAMPLE_CONVERT_DSP
+#include <arm_acle.h>
+#endif
+
+#define RAMP_FRAMES (MIC_GAIN_RAMP_MS * MIC_FRAMES_PER_MS)
+
+bool mic_mute[MIC_CHANNELS + 1];
+int16_t mic_volume[MIC_CHANNELS + 1];
+
+static int32_t gain_acc[MIC_CHANNELS];      // gain in use, Q14 with 8 more fraction bits for the ramp
+static int32_t gain_step[MIC_CHANNELS];     // added to gain_acc every frame while ramping
+static int32_t gain_target[MIC_CHANNELS];   // Q14
+static int ramp_left[MIC_CHANNELS];         // frames
+
+void mic_gain_init(void) {
+    for (int c = 0; c <= MIC_CHANNELS; c++) {
+        mic_mute[c] = false;
+        mic_volume[c] = 0;
+    }
+    for (int c = 0; c < MIC_CHANNELS; c++) {
+        gain_target[c] = MIC_GAIN_UNITY;
+        gain_acc[c] = MIC_GAIN_UNITY << 8;
+        ramp_left[c] = 0;
+    }
+}
+
+void mic_gain_changed(void) {
+    for (int c = 0; c < MIC_CHANNELS; c++) {
+        int32_t target = 0;
+        bool silent = mic_mute[0] || mic_mute[c + 1] ||
+                      mic_volume[0] == MIC_VOLUME_SILENT || mic_volume[c + 1] == MIC_VOLUME_SILENT;
+        if (!silent) {
+            int32_t volume = mic_volume[0] + mic_volume[c + 1];         // 1/256 dB
+            if (volume > MIC_VOLUME_MAX) volume = MIC_VOLUME_MAX;
+            target = (int32_t)lroundf(MIC_GAIN_UNITY * powf(10.0f, volume / (256.0f * 20.0f)));
+        }
+        if (target == gain_target[c]) continue;
+        gain_target[c] = target;
+        gain_step[c] = ((target << 8) - gain_acc[c]) / RAMP_FRAMES;
+        ramp_left[c] = RAMP_FRAMES;
+    }
+}
+
+// s * g / 2^14 for a normalized sample s and Q14 gain g, saturated
+#if SAMPLE_CONVERT_DSP
+static inline int32_t scale(int32_t s, int32_t g) {
+    int32_t u = (int32_t)(((int64_t)s * g) >> 16);                     // s * g / 2^16
+    return (__ssat(u, 30) * 4) & SAMPLE_CONVERT_MASK;
+}
+#else
+static inline int32_t scale(int32_t s, int32_t g) {
+    int32_t u = (s >> 16) * g + (int32_t)(((((uint32_t)s >> 8) & 0xFF) * (uint32_t)g) >> 8);   // s * g / 2^16
+    if (u > (INT32_MAX >> 2)) return INT32_MAX & SAMPLE_CONVERT_MASK;
+    if (u < (INT32_MIN >> 2)) return INT32_MIN;
+    return (u * 4) & SAMPLE_CONVERT_MASK;
+}
+#endif
+
+bool mic_gain_apply(int32_t* dst, const int32_t* src, int frames) {
+    bool unity = true;
+    for (int c = 0; c < MIC_CHANNELS; c++) {
+        if (ramp_left[c] || gain_acc[c] != MIC_GAIN_UNITY << 8) unity = false;
+    }
+    if (unity) return false;
+
+    for (int c = 0; c < MIC_CHANNELS; c++) {
+        const int32_t* in = src + c;
+        int32_t* out = dst + c;
+        int32_t acc = gain_acc[c];
+        int i = 0;
+        int ramp = ramp_left[c] < frames ? ramp_left[c] : frames;
+        for (; i < ramp; i++, in += MIC_CHANNELS, out += MIC_CHANNELS) {
+            *out = scale(*in, acc >> 8);
+            acc += gain_step[c];
+        }
+        if (ramp) {
+            ramp_left[c] -= ramp;
+            if (ramp_left[c] == 0) acc = gain_target[c] << 8;             // land exactly, the step was rounded
+        }
+        gain_acc[c] = acc;
+
+        int32_t g = acc >> 8;
+        if (g == MIC_GAIN_UNITY) {
+            for (; i < frames; i++, in += MIC_CHANNELS, out += MIC_CHANNELS) *out = *in;
+        } else if (g == 0) {
+            for (; i < frames; i++, out += MIC_CHANNELS) *out = 0;
+        } else {
+            for (; i < frames; i++, in += MIC_CHANNELS, out += MIC_CHANNELS) *out = scale(*in, g);
+        }
+    }
+    return true;
+}
@@ -0,0 +1,74 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (C) 2025 The Whaley Group
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#ifndef _MIC_GAIN_H_
+#define _MIC_GAIN_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "mic_config.h"
+
+// Volume control range reported to the host, in the UAC2 unit of 1/256 dB
+#ifndef MIC_VOLUME_MIN
+#define MIC_VOLUME_MIN (-60 * 256)          // -60 dB
+#endif
+
+#ifndef MIC_VOLUME_MAX
+#define MIC_VOLUME_MAX (12 * 256)           // +12 dB, a gain of 65226, the most below 65536
+#endif
+
+#ifndef MIC_VOLUME_RES
+#define MIC_VOLUME_RES 128                  // 0.5 dB steps
+#endif
+
+#ifndef MIC_GAIN_RAMP_MS
+#define MIC_GAIN_RAMP_MS 10                 // time to move to a new gain, including mute and unmute
+#endif
+
+#define MIC_VOLUME_SILENT (-32768)          // 0x8000, -infinity dB: gain 0, as mute
+
+#define MIC_GAIN_UNITY 16384                // Q14
+
+#if MIC_VOLUME_MAX > 12 * 256
+#error "the gain is unsigned Q14 below 65536 (+12.04 dB), MIC_VOLUME_MAX can be at most +12 dB"
+#endif
+
+// Feature unit controls, index 0 is the master channel and 1.. the microphones.
+// Written by the audio control requests, then mic_gain_changed() is called.  A
+// volume is MIC_VOLUME_MIN to MIC_VOLUME_MAX, or MIC_VOLUME_SILENT.
+extern bool mic_mute[MIC_CHANNELS + 1];
+extern int16_t mic_volume[MIC_CHANNELS + 1];
+
+void mic_gain_init(void);
+
+// start ramping every channel to the gain its controls now ask for
+void mic_gain_changed(void);
+
+// Scale one block of interleaved normalized SE_32 frames into dst, saturating at
+// full scale.  Returns false, leaving dst untouched, when every channel is at
+// unity gain so the caller can send src as it is.
+bool mic_gain_apply(int32_t* dst, const int32_t* src, int frames);
+
+#endif
@@ -0,0 +1,328 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (C) 2025 The Whaley Group
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+/*
+Per sample conversion kernels for the dma and USB paths.
+
+The PIO assembles each microphone word with the msb in bit 31 and leaves the
+bits below MIC_SAMPLE_BITS undefined.  Every kernel here drops those bits, so
+whatever format it produces is clean: SE_32 with the low bits zeroed, 16 bit
+rounded and saturated, packed 24 bit, or the same words split into or merged
+from one array per channel.
+
+The interpolator versions give each lane one shift-mask step per sample:
+  normalize, (de)interleave   lane mask keeps the sample bits
+  16 bit                      interp1 lane0 shifts by 15 and clamps in the same
+                              access, leaving one add and shift for the rounding
+  24 bit                      PEEK_FULL adds two lanes, so one read gives the low
+                              bytes of one sample merged with the high bytes of
+                              the next
+The M0+ already masks in a single cycle, so the plain copies only gain where a
+lane saves more than the write and read it costs.  Run the benchmark on the
+target and set SAMPLE_CONVERT_INTERP from its numbers.
+
+On the RP2350 the Cortex-M33 DSP instructions do better where saturation is the
+cost: QADD adds the rounding half lsb with saturation, so the 16 bit result is
+just the top half of the word, and two of those pack into one store with PKHTB.
+The other kernels are a load, mask and store either way and keep their C version.
+
+An interpolator is per core state that any code may use, so the interpolator
+versions save it on entry and restore it on exit.  That is a few dozen cycles per
+call, small against a block, and makes them safe in the dma interrupt.
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include "pico/stdlib.h"
+#include "hardware/interp.h"
+#include "hardware/sync.h"
+#include "hardware/structs/systick.h"
+#include "sample_convert.h"
+
+#if SAMPLE_CONVERT_DSP
+#include <arm_acle.h>
+#endif
+
+#define SAMPLE_LSB (32 - MIC_SAMPLE_BITS)                   // lowest bit holding the sample
+
+#if MIC_SAMPLE_BITS < 17
+#define S16_INPUT(x) ((x) & SAMPLE_CONVERT_MASK)            // rounding bit 15 would be undefined
+#else
+#define S16_INPUT(x) (x)
+#endif
+
+#if MIC_SAMPLE_BITS < 24
+#define S24_INPUT(x) ((x) & SAMPLE_CONVERT_MASK)
+#else
+#define S24_INPUT(x) (x)
+#endif
+
+// ---- portable C
+
+void convert_normalize_c(int32_t* dst, const int32_t* src, int n) {
+    const int32_t mask = SAMPLE_CONVERT_MASK;
+    for (int i = 0; i < n; i++) dst[i] = src[i] & mask;
+}
+
+void convert_to_s16_c(int16_t* dst, const int32_t* src, int n) {
+    for (int i = 0; i < n; i++) {
+        int32_t r = S16_INPUT(src[i]) >> 15;                // 17 bits, half an lsb below the result
+        if (r > 65534) r = 65534;                           // only the top can overflow when rounded up
+        dst[i] = (int16_t)((r + 1) >> 1);
+    }
+}
+
+void convert_to_s24_c(uint8_t* dst, const int32_t* src, int n) {
+    uint32_t* out = (uint32_t*)dst;                         // 4 samples make 3 whole words
+    for (int i = 0; i < n; i += 4) {
+        uint32_t s0 = (uint32_t)S24_INPUT(src[i]) >> 8, s1 = (uint32_t)S24_INPUT(src[i + 1]) >> 8;
+        uint32_t s2 = (uint32_t)S24_INPUT(src[i + 2]) >> 8, s3 = (uint32_t)S24_INPUT(src[i + 3]) >> 8;
+        *out++ = s0 | (s1 << 24);
+        *out++ = (s1 >> 8) | (s2 << 16);
+        *out++ = (s2 >> 16) | (s3 << 8);
+    }
+}
+
+void convert_deinterleave_c(int32_t* const* planar, const int32_t* interleaved, int frames) {
+    const int32_t mask = SAMPLE_CONVERT_MASK;
+    for (int i = 0; i < frames; i++) {
+        for (int c = 0; c < MIC_CHANNELS; c++) planar[c][i] = *interleaved++ & mask;
+    }
+}
+
+void convert_interleave_c(int32_t* interleaved, const int32_t* const* planar, int frames) {
+    const int32_t mask = SAMPLE_CONVERT_MASK;
+    for (int i = 0; i < frames; i++) {
+        for (int c = 0; c < MIC_CHANNELS; c++) *interleaved++ = planar[c][i] & mask;
+    }
+}
+
+// ---- hardware interpolator
+
+static void lane_config(interp_hw_t* interp, uint lane, uint shift, uint mask_lsb, uint mask_msb, bool is_signed) {
+    interp_config cfg = interp_default_config();
+    interp_config_set_shift(&cfg, shift);
+    interp_config_set_mask(&cfg, mask_lsb, mask_msb);
+    interp_config_set_signed(&cfg, is_signed);
+    interp_set_config(interp, lane, &cfg);
+    interp_set_base(interp, lane, 0);
+}
+
+// interp0 lane0 passes the sample bits, nothing else
+static void mask_lane_begin(interp_hw_save_t* saved) {
+    interp_save(interp0, saved);
+    lane_config(interp0, 0, 0, SAMPLE_LSB, 31, false);
+}
+
+void convert_normalize_interp(int32_t* dst, const int32_t* src, int n) {
+    interp_hw_save_t saved;
+    mask_lane_begin(&saved);
+    for (int i = 0; i < n; i++) {
+        interp_set_accumulator(interp0, 0, (uint32_t)src[i]);
+        dst[i] = (int32_t)interp_peek_lane_result(interp0, 0);
+    }
+    interp_restore(interp0, &saved);
+}
+
+void convert_to_s16_interp(int16_t* dst, const int32_t* src, int n) {
+    interp_hw_save_t saved;
+    interp_save(interp1, &saved);                           // only interp1 lane0 can clamp
+    interp_config cfg = interp_default_config();
+    interp_config_set_shift(&cfg, 15);
+    interp_config_set_mask(&cfg, 0, 16);
+    interp_config_set_signed(&cfg, true);
+    interp_config_set_clamp(&cfg, true);
+    interp_set_config(interp1, 0, &cfg);
+    interp_set_base(interp1, 0, (uint32_t)-65536);          // clamp limits, as convert_to_s16_c
+    interp_set_base(interp1, 1, 65534);
+    for (int i = 0; i < n; i++) {
+        interp_set_accumulator(interp1, 0, (uint32_t)S16_INPUT(src[i]));
+        dst[i] = (int16_t)(((int32_t)interp_peek_lane_result(interp1, 0) + 1) >> 1);
+    }
+    interp_restore(interp1, &saved);
+}
+
+void convert_to_s24_interp(uint8_t* dst, const int32_t* src, int n) {
+    interp_hw_save_t saved0, saved1;
+    interp_save(interp0, &saved0);
+    interp_save(interp1, &saved1);
+    lane_config(interp0, 0, 8, 0, 23, false);               // word 0: bytes 1-3 of s0 ...
+    lane_config(interp0, 1, 0, 24, 31, false);              //         ... then byte 1 of s1, pre-shifted by 16
+    lane_config(interp1, 0, 16, 0, 15, false);              // word 1: bytes 2-3 of s1 ...
+    lane_config(interp1, 1, 0, 16, 31, false);              //         ... then bytes 1-2 of s2, pre-shifted by 8
+    interp_set_base(interp0, 2, 0);
+    interp_set_base(interp1, 2, 0);
+    uint32_t* out = (uint32_t*)dst;
+    for (int i = 0; i < n; i += 4) {
+        uint32_t s1 = (uint32_t)S24_INPUT(src[i + 1]), s2 = (uint32_t)S24_INPUT(src[i + 2]);
+        interp_set_accumulator(interp0, 0, (uint32_t)S24_INPUT(src[i]));
+        interp_set_accumulator(interp0, 1, s1 << 16);
+        interp_set_accumulator(interp1, 0, s1);
+        interp_set_accumulator(interp1, 1, s2 << 8);
+        *out++ = interp_peek_full_result(interp0);
+        *out++ = interp_peek_full_result(interp1);
+        *out++ = (s2 >> 24) | ((uint32_t)S24_INPUT(src[i + 3]) & 0xFFFFFF00u);   // byte 3 of s2, then s3 in place
+    }
+    interp_restore(interp1, &saved1);
+    interp_restore(interp0, &saved0);
+}
+
+void convert_deinterleave_interp(int32_t* const* planar, const int32_t* interleaved, int frames) {
+    interp_hw_save_t saved;
+    mask_lane_begin(&saved);
+    for (int i = 0; i < frames; i++) {
+        for (int c = 0; c < MIC_CHANNELS; c++) {
+            interp_set_accumulator(interp0, 0, (uint32_t)*interleaved++);
+            planar[c][i] = (int32_t)interp_peek_lane_result(interp0, 0);
+        }
+    }
+    interp_restore(interp0, &saved);
+}
+
+void convert_interleave_interp(int32_t* interleaved, const int32_t* const* planar, int frames) {
+    interp_hw_save_t saved;
+    mask_lane_begin(&saved);
+    for (int i = 0; i < frames; i++) {
+        for (int c = 0; c < MIC_CHANNELS; c++) {
+            interp_set_accumulator(interp0, 0, (uint32_t)planar[c][i]);
+            *interleaved++ = (int32_t)interp_peek_lane_result(interp0, 0);
+        }
+    }
+    interp_restore(interp0, &saved);
+}
+
+// ---- Cortex-M33 DSP instructions
+
+#if SAMPLE_CONVERT_DSP
+
+// (x + 2^15) >> 16 saturated equals the rounding and clamp of convert_to_s16_c
+void convert_to_s16_dsp(int16_t* dst, const int32_t* src, int n) {
+    uint32_t* out = (uint32_t*)dst;
+    int i = 0;
+    for (; i + 1 < n; i += 2) {
+        uint32_t lo = (uint32_t)__qadd(S16_INPUT(src[i]), 0x8000);
+        uint32_t hi = (uint32_t)__qadd(S16_INPUT(src[i + 1]), 0x8000);
+        *out++ = (hi & 0xFFFF0000u) | (lo >> 16);           // PKHTB
+    }
+    if (i < n) dst[i] = (int16_t)(__qadd(S16_INPUT(src[i]), 0x8000) >> 16);
+}
+
+#endif
+
+// ---- on target benchmark
+
+#if SAMPLE_CONVERT_BENCHMARK
+
+#define BENCH_SAMPLES (16 * MIC_BLOCK_FRAMES)               // one block of a 16 channel array
+#define BENCH_FRAMES (BENCH_SAMPLES / MIC_CHANNELS)
+
+static int32_t bench_src[BENCH_SAMPLES];
+static int32_t bench_out[2][BENCH_SAMPLES];                 // C result, interpolator or DSP result
+static int32_t bench_planar[2][MIC_CHANNELS][BENCH_FRAMES];
+
+static uint32_t bench_start(void) {
+    systick_hw->rvr = 0x00FFFFFF;
+    systick_hw->cvr = 0;
+    systick_hw->csr = 0x5;                                  // enable, processor clock, no interrupt
+    return systick_hw->cvr;
+}
+
+static uint32_t bench_cycles(uint32_t start) {
+    return (start - systick_hw->cvr) & 0x00FFFFFF;          // counts down, wraps at 2^24
+}
+
+static void bench_print(const char* name, const char* version, uint32_t c_cycles, uint32_t other_cycles, bool same) {
+    printf("convert %-12s c %4lu.%02lu  %-6s %4lu.%02lu cycles/sample%s\n", name,
+           (unsigned long)(c_cycles / BENCH_SAMPLES), (unsigned long)(c_cycles * 100 / BENCH_SAMPLES % 100), version,
+           (unsigned long)(other_cycles / BENCH_SAMPLES), (unsigned long)(other_cycles * 100 / BENCH_SAMPLES % 100),
+           same ? "" : "  MISMATCH");
+}
+
+void sample_convert_benchmark(void) {
+    uint32_t seed = 12345;
+    for (int i = 0; i < BENCH_SAMPLES; i++) {
+        seed = seed * 1664525u + 1013904223u;
+        bench_src[i] = (int32_t)seed;
+    }
+    bench_src[0] = INT32_MAX;                               // the saturation cases
+    bench_src[1] = INT32_MIN;
+    bench_src[2] = (int32_t)0x7FFF8000;
+
+    int32_t* planar_out[2][MIC_CHANNELS];
+    const int32_t* planar_in[2][MIC_CHANNELS];
+    for (int k = 0; k < 2; k++) {
+        for (int c = 0; c < MIC_CHANNELS; c++) {
+            planar_out[k][c] = bench_planar[k][c];
+            planar_in[k][c] = bench_planar[k][c];
+        }
+    }
+
+    uint32_t irq = save_and_disable_interrupts();
+    uint32_t t, c_cycles, interp_cycles;
+    bool same;
+
+    t = bench_start(); convert_normalize_c(bench_out[0], bench_src, BENCH_SAMPLES); c_cycles = bench_cycles(t);
+    t = bench_start(); convert_normalize_interp(bench_out[1], bench_src, BENCH_SAMPLES); interp_cycles = bench_cycles(t);
+    same = memcmp(bench_out[0], bench_out[1], BENCH_SAMPLES * sizeof(int32_t)) == 0;
+    restore_interrupts(irq);
+    bench_print("normalize", "interp", c_cycles, interp_cycles, same);
+
+    irq = save_and_disable_interrupts();
+    t = bench_start(); convert_to_s16_c((int16_t*)bench_out[0], bench_src, BENCH_SAMPLES); c_cycles = bench_cycles(t);
+    t = bench_start(); convert_to_s16_interp((int16_t*)bench_out[1], bench_src, BENCH_SAMPLES); interp_cycles = bench_cycles(t);
+    same = memcmp(bench_out[0], bench_out[1], BENCH_SAMPLES * sizeof(int16_t)) == 0;
+    restore_interrupts(irq);
+    bench_print("to_s16", "interp", c_cycles, interp_cycles, same);
+#if SAMPLE_CONVERT_DSP
+    irq = save_and_disable_interrupts();
+    t = bench_start(); convert_to_s16_dsp((int16_t*)bench_out[1], bench_src, BENCH_SAMPLES); interp_cycles = bench_cycles(t);
+    same = memcmp(bench_out[0], bench_out[1], BENCH_SAMPLES * sizeof(int16_t)) == 0;
+    restore_interrupts(irq);
+    bench_print("to_s16", "dsp", c_cycles, interp_cycles, same);
+#endif
+
+    irq = save_and_disable_interrupts();
+    t = bench_start(); convert_to_s24_c((uint8_t*)bench_out[0], bench_src, BENCH_SAMPLES); c_cycles = bench_cycles(t);
+    t = bench_start(); convert_to_s24_interp((uint8_t*)bench_out[1], bench_src, BENCH_SAMPLES); interp_cycles = bench_cycles(t);
+    same = memcmp(bench_out[0], bench_out[1], BENCH_SAMPLES * 3) == 0;
+    restore_interrupts(irq);
+    bench_print("to_s24", "interp", c_cycles, interp_cycles, same);
+
+    irq = save_and_disable_interrupts();
+    t = bench_start(); convert_deinterleave_c(planar_out[0], bench_src, BENCH_FRAMES); c_cycles = bench_cycles(t);
+    t = bench_start(); convert_deinterleave_interp(planar_out[1], bench_src, BENCH_FRAMES); interp_cycles = bench_cycles(t);
+    same = memcmp(bench_planar[0], bench_planar[1], sizeof(bench_planar[0])) == 0;
+    restore_interrupts(irq);
+    bench_print("deinterleave", "interp", c_cycles, interp_cycles, same);
+
+    irq = save_and_disable_interrupts();
+    t = bench_start(); convert_interleave_c(bench_out[0], planar_in[0], BENCH_FRAMES); c_cycles = bench_cycles(t);
+    t = bench_start(); convert_interleave_interp(bench_out[1], planar_in[1], BENCH_FRAMES); interp_cycles = bench_cycles(t);
+    same = memcmp(bench_out[0], bench_out[1], BENCH_SAMPLES * sizeof(int32_t)) == 0;
+    restore_interrupts(irq);
+    bench_print("interleave", "interp", c_cycles, interp_cycles, same);
+}
+
+#endif
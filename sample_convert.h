@@ -0,0 +1,98 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (C) 2025 The Whaley Group
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#ifndef _SAMPLE_CONVERT_H_
+#define _SAMPLE_CONVERT_H_
+
+#include <stdint.h>
+#include "mic_config.h"
+
+#ifndef SAMPLE_CONVERT_INTERP
+#define SAMPLE_CONVERT_INTERP 0             // 1 = hardware interpolator kernels, 0 = portable C
+#endif
+
+#ifndef SAMPLE_CONVERT_DSP
+#if defined(__ARM_FEATURE_DSP) && __ARM_FEATURE_DSP
+#define SAMPLE_CONVERT_DSP 1                // Cortex-M33 (RP2350): saturating and packing instructions
+#else
+#define SAMPLE_CONVERT_DSP 0                // M0+ (RP2040) and hosts
+#endif
+#endif
+
+#ifndef SAMPLE_CONVERT_BENCHMARK
+#define SAMPLE_CONVERT_BENCHMARK 0          // 1 = time the versions at start up and print over the uart
+#endif
+
+#define SAMPLE_CONVERT_MASK ((int32_t)(0xFFFFFFFFu << (32 - MIC_SAMPLE_BITS)))     // bits holding the sample
+
+// Every kernel reads raw PIO words, msb in bit 31 and undefined bits below
+// MIC_SAMPLE_BITS, and drops those bits.  _c is portable, _interp uses the
+// core's interpolators; SAMPLE_CONVERT_INTERP picks what the plain names call.
+// Where there is a _dsp version (M33 DSP instructions) it is used when
+// SAMPLE_CONVERT_DSP is set, whatever SAMPLE_CONVERT_INTERP says.
+
+// dst[i] = src[i] with the undefined low bits cleared, sign and msb alignment kept
+void convert_normalize_c(int32_t* dst, const int32_t* src, int n);
+void convert_normalize_interp(int32_t* dst, const int32_t* src, int n);
+
+// 16 bit, rounded to nearest and saturated
+void convert_to_s16_c(int16_t* dst, const int32_t* src, int n);
+void convert_to_s16_interp(int16_t* dst, const int32_t* src, int n);
+void convert_to_s16_dsp(int16_t* dst, const int32_t* src, int n);         // dst word aligned
+
+// 24 bit little endian, 3 bytes per sample, n a multiple of 4 and dst word aligned
+void convert_to_s24_c(uint8_t* dst, const int32_t* src, int n);
+void convert_to_s24_interp(uint8_t* dst, const int32_t* src, int n);
+
+// interleaved frames of MIC_CHANNELS samples to one array per channel, and back
+void convert_deinterleave_c(int32_t* const* planar, const int32_t* interleaved, int frames);
+void convert_deinterleave_interp(int32_t* const* planar, const int32_t* interleaved, int frames);
+void convert_interleave_c(int32_t* interleaved, const int32_t* const* planar, int frames);
+void convert_interleave_interp(int32_t* interleaved, const int32_t* const* planar, int frames);
+
+#if SAMPLE_CONVERT_INTERP
+#define convert_normalize convert_normalize_interp
+#define convert_to_s16 convert_to_s16_interp
+#define convert_to_s24 convert_to_s24_interp
+#define convert_deinterleave convert_deinterleave_interp
+#define convert_interleave convert_interleave_interp
+#else
+#define convert_normalize convert_normalize_c
+#define convert_to_s16 convert_to_s16_c
+#define convert_to_s24 convert_to_s24_c
+#define convert_deinterleave convert_deinterleave_c
+#define convert_interleave convert_interleave_c
+#endif
+
+#if SAMPLE_CONVERT_DSP
+#undef convert_to_s16
+#define convert_to_s16 convert_to_s16_dsp
+#endif
+
+// time every kernel in each of its versions, check they agree and print the cycles per
+// sample over stdio; only built with SAMPLE_CONVERT_BENCHMARK
+void sample_convert_benchmark(void);
+
+#endif
@@ -0,0 +1,284 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (C) 2025 The Whaley Group
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+/*
+Band energy spectrum of both channels, computed on core1.
+
+The two channels are packed into one complex FFT, left as the real part and right
+as the imaginary part, and separated afterwards using the conjugate symmetry of a
+real signal's spectrum.  That halves the work against two real FFTs.
+
+The FFT is a radix-2 decimation in time on 16 bit data with Q15 twiddles, which
+the M0+ multiplies in one cycle.  It is block floating point: the input frame is
+shifted so its peak sits just under 2^13, and before each stage the data is
+shifted down once or twice if the previous stage grew past 2^13 or 2^14, which
+keeps every butterfly inside 16 bits.  The shifts are counted and folded back in
+when the band powers are accumulated (in float, a few dozen adds per FFT).
+
+Frames are Hann windowed with 50% overlap.  Bin powers are summed into bands of
+1/SPECTRUM_BANDS_PER_OCTAVE octave; the lowest third-octave bands are narrower
+than a bin at the default size, so they use the nearest single bin.
+*/
+
+#include <math.h>
+#include <string.h>
+#include "pico/sync.h"
+#include "hardware/structs/systick.h"
+#include "spectrum.h"
+
+#define FFT_N SPECTRUM_FFT_SIZE
+#define FFT_HOP (FFT_N / 2)
+#define FFT_HEADROOM_BITS 13                                // data kept below 2^13 going into each stage
+
+volatile uint16_t spectrum_interval_ms = SPECTRUM_INTERVAL_MS;
+volatile uint32_t spectrum_cycles_per_block;
+
+static int32_t input[2][FFT_N];                             // 24 bit samples, oldest first
+static int input_fill;
+static int16_t fft_re[FFT_N];
+static int16_t fft_im[FFT_N];
+static int16_t window[FFT_N];                               // Hann, Q15
+static int16_t twiddle_cos[FFT_N / 2];                      // Q15 cos(2 pi k / N)
+static int16_t twiddle_sin[FFT_N / 2];                      // Q15 -sin(2 pi k / N)
+static uint16_t bit_reverse[FFT_N];
+static uint16_t band_lo[SPECTRUM_BANDS];                    // first and last bin of each band
+static uint16_t band_hi[SPECTRUM_BANDS];
+static float level_scale;                                   // band power to power relative to a full scale sine
+
+static float band_power[2][SPECTRUM_BANDS];
+static uint32_t frames_averaged;
+static uint32_t ffts_averaged;
+static uint32_t hop_cycles;
+static uint32_t hop_blocks;
+
+static critical_section_t report_lock;                      // report is written on core1, read on core0
+static uint8_t report[SPECTRUM_REPORT_LEN];
+static uint8_t report_seq;
+static bool report_pending;
+
+
+void spectrum_init(void) {
+    int bits = 0;
+    while ((1 << bits) < FFT_N) bits++;
+    float window_power = 0;
+    for (int i = 0; i < FFT_N; i++) {
+        float w = 0.5f - 0.5f * cosf(2.0f * (float)M_PI * i / FFT_N);     // periodic Hann, exact for 50% overlap
+        window[i] = (int16_t)(w * 32767.0f + 0.5f);
+        window_power += (window[i] / 32768.0f) * (window[i] / 32768.0f);
+        uint32_t r = 0;
+        for (int b = 0; b < bits; b++) r |= ((i >> b) & 1u) << (bits - 1 - b);
+        bit_reverse[i] = (uint16_t)r;
+    }
+    window_power /= FFT_N;
+    for (int k = 0; k < FFT_N / 2; k++) {
+        twiddle_cos[k] = (int16_t)lroundf(32767.0f * cosf(2.0f * (float)M_PI * k / FFT_N));
+        twiddle_sin[k] = (int16_t)lroundf(-32767.0f * sinf(2.0f * (float)M_PI * k / FFT_N));
+    }
+
+    float bin_hz = (float)MIC_SAMPLE_RATE / FFT_N;
+    float half_band = powf(2.0f, 0.5f / SPECTRUM_BANDS_PER_OCTAVE);
+    for (int b = 0; b < SPECTRUM_BANDS; b++) {
+        float centre = SPECTRUM_TOP_HZ * powf(2.0f, (float)(b - (SPECTRUM_BANDS - 1)) / SPECTRUM_BANDS_PER_OCTAVE);
+        int lo = (int)ceilf(centre / half_band / bin_hz);
+        int hi = (int)ceilf(centre * half_band / bin_hz) - 1;
+        if (hi < lo) lo = hi = (int)lroundf(centre / bin_hz);     // band narrower than a bin
+        if (lo < 1) lo = 1;                                       // never the DC bin
+        if (hi > FFT_N / 2 - 1) hi = FFT_N / 2 - 1;
+        band_lo[b] = (uint16_t)lo;
+        band_hi[b] = (uint16_t)hi;
+    }
+
+    // Separated bin power P of a sine of amplitude A (1.0 = full scale) is
+    // (A N sum(w) / 2N)^2 spread over the window's bins; summed over those bins it is
+    // A^2 N^2 window_power / 4.  Dividing by that for A = 1 gives power relative to a
+    // full scale sine.  Samples are 24 bit, so full scale is 2^23.
+    level_scale = 4.0f / ((float)FFT_N * FFT_N * window_power) / (8388608.0f * 8388608.0f);
+
+    critical_section_init(&report_lock);
+    spectrum_reset();
+}
+
+void spectrum_reset(void) {
+    input_fill = 0;
+    frames_averaged = 0;
+    ffts_averaged = 0;
+    hop_cycles = 0;
+    hop_blocks = 0;
+    memset(band_power, 0, sizeof(band_power));
+}
+
+static int bit_length(uint32_t v) {
+    return v ? 32 - __builtin_clz(v) : 0;
+}
+
+// In place FFT of fft_re/fft_im, input already in bit reversed order and below
+// 2^FFT_HEADROOM_BITS.  Returns the number of right shifts applied on the way.
+static int fft_block_float(void) {
+    int shifts = 0;
+    int32_t peak = 0;                                         // largest component written by the last stage
+    for (int len = 2, step = FFT_N / 2; len <= FFT_N; len <<= 1, step >>= 1) {
+        int sh = peak >= (1 << (FFT_HEADROOM_BITS + 1)) ? 2 : peak >= (1 << FFT_HEADROOM_BITS) ? 1 : 0;
+        shifts += sh;
+        int32_t round_t = 1 << (14 + sh);                     // round rather than truncate, truncation bias
+        int32_t round_a = (1 << sh) >> 1;                     // piles up over the stages as a noise floor
+        peak = 0;
+        int half = len >> 1;
+        for (int start = 0; start < FFT_N; start += len) {
+            for (int j = 0; j < half; j++) {
+                int a = start + j;
+                int b = a + half;
+                int32_t wr = twiddle_cos[j * step];
+                int32_t wi = twiddle_sin[j * step];
+                int32_t br = fft_re[b];
+                int32_t bi = fft_im[b];
+                int32_t tr = (br * wr - bi * wi + round_t) >> (15 + sh);
+                int32_t ti = (br * wi + bi * wr + round_t) >> (15 + sh);
+                int32_t ar = (fft_re[a] + round_a) >> sh;
+                int32_t ai = (fft_im[a] + round_a) >> sh;
+                int32_t v0 = ar + tr, v1 = ai + ti, v2 = ar - tr, v3 = ai - ti;
+                fft_re[a] = (int16_t)v0;
+                fft_im[a] = (int16_t)v1;
+                fft_re[b] = (int16_t)v2;
+                fft_im[b] = (int16_t)v3;
+                int32_t m = (v0 < 0 ? -v0 : v0) | (v1 < 0 ? -v1 : v1) | (v2 < 0 ? -v2 : v2) | (v3 < 0 ? -v3 : v3);
+                if (m > peak) peak = m;                           // or of magnitudes keeps the top bit, enough for the test
+            }
+        }
+    }
+    return shifts;
+}
+
+static void publish_report(void) {
+    uint8_t levels[2 * SPECTRUM_BANDS];
+    for (int ch = 0; ch < 2; ch++) {
+        for (int b = 0; b < SPECTRUM_BANDS; b++) {
+            float p = band_power[ch][b] / ffts_averaged * level_scale;
+            float below = p > 0 ? -20.0f * log10f(p) : 255.0f;     // 0.5 dB steps: 10 log10 * 2
+            if (below < 0) below = 0;
+            if (below > 255) below = 255;
+            levels[ch * SPECTRUM_BANDS + b] = (uint8_t)(below + 0.5f);
+        }
+    }
+    critical_section_enter_blocking(&report_lock);
+    report[0] = ++report_seq;
+    memcpy(&report[1], levels, sizeof(levels));
+    report_pending = true;
+    critical_section_exit(&report_lock);
+}
+
+// Window the input frame into fft_re/fft_im and transform it.  Returns the exponent
+// of the result: a bin holding v stands for v * 2^exponent in input lsbs.
+static int transform_input(void) {
+    int32_t peak = 0;
+    for (int i = 0; i < FFT_N; i++) {
+        int32_t l = input[0][i], r = input[1][i];
+        peak |= (l < 0 ? -l : l) | (r < 0 ? -r : r);
+    }
+    int pre = bit_length(peak) - FFT_HEADROOM_BITS;           // right shift into the headroom, negative = left
+    for (int i = 0; i < FFT_N; i++) {
+        int32_t l = pre >= 0 ? input[0][i] >> pre : input[0][i] * (1 << -pre);
+        int32_t r = pre >= 0 ? input[1][i] >> pre : input[1][i] * (1 << -pre);
+        int j = bit_reverse[i];
+        fft_re[j] = (int16_t)((l * window[i]) >> 15);
+        fft_im[j] = (int16_t)((r * window[i]) >> 15);
+    }
+    return pre + fft_block_float();
+}
+
+// power of bin k of each channel, separated from the packed transform, in units of 2^(2 * exponent)
+static inline void separate_bin(int k, uint32_t* power_l, uint32_t* power_r) {
+    int32_t xr = fft_re[k], xi = fft_im[k];
+    int32_t yr = fft_re[FFT_N - k], yi = fft_im[FFT_N - k];
+    int32_t lr = (xr + yr) >> 1, li = (xi - yi) >> 1;         // L = (X[k] + conj X[N-k]) / 2
+    int32_t rr = (xi + yi) >> 1, ri = (yr - xr) >> 1;         // R = (X[k] - conj X[N-k]) / 2j
+    *power_l = (uint32_t)(lr * lr + li * li);
+    *power_r = (uint32_t)(rr * rr + ri * ri);
+}
+
+static void process_hop(void) {
+    float unit = ldexpf(1.0f, 2 * transform_input());
+
+    for (int b = 0; b < SPECTRUM_BANDS; b++) {
+        uint64_t sum_l = 0, sum_r = 0;
+        for (int k = band_lo[b]; k <= band_hi[b]; k++) {
+            uint32_t power_l, power_r;
+            separate_bin(k, &power_l, &power_r);
+            sum_l += power_l;
+            sum_r += power_r;
+        }
+        band_power[0][b] += (float)sum_l * unit;
+        band_power[1][b] += (float)sum_r * unit;
+    }
+    ffts_averaged++;
+
+    memcpy(input[0], &input[0][FFT_HOP], FFT_HOP * sizeof(int32_t));   // 50% overlap
+    memcpy(input[1], &input[1][FFT_HOP], FFT_HOP * sizeof(int32_t));
+    input_fill = FFT_HOP;
+}
+
+void spectrum_add_block(const int (*block)[MIC_CHANNELS], int frames) {
+    if (!(systick_hw->csr & 1)) {                             // cycle counter of whichever core runs this
+        systick_hw->rvr = 0x00FFFFFF;
+        systick_hw->cvr = 0;
+        systick_hw->csr = 0x5;                                // enable, processor clock, no interrupt
+    }
+    uint32_t start = systick_hw->cvr;
+
+    bool hopped = false;
+    for (int i = 0; i < frames; i++) {
+        input[0][input_fill] = block[i][0] >> 8;              // 24 bit mic data sits in bits 31-8
+        input[1][input_fill] = block[i][1] >> 8;
+        if (++input_fill == FFT_N) {
+            process_hop();
+            hopped = true;
+        }
+    }
+    frames_averaged += frames;
+    uint32_t period = (uint32_t)spectrum_interval_ms * MIC_FRAMES_PER_MS;
+    if (ffts_averaged && period && frames_averaged >= period) {
+        publish_report();
+        frames_averaged = 0;
+        ffts_averaged = 0;
+        memset(band_power, 0, sizeof(band_power));
+    }
+
+    hop_cycles += (start - systick_hw->cvr) & 0x00FFFFFF;     // counts down, wraps at 2^24
+    hop_blocks++;
+    if (hopped) {
+        uint32_t per_block = hop_cycles / hop_blocks;
+        if (per_block > spectrum_cycles_per_block) spectrum_cycles_per_block = per_block;
+        hop_cycles = 0;
+        hop_blocks = 0;
+    }
+}
+
+bool spectrum_take_report(uint8_t* dst) {
+    critical_section_enter_blocking(&report_lock);
+    bool pending = report_pending;
+    if (pending) memcpy(dst, report, SPECTRUM_REPORT_LEN);
+    report_pending = false;
+    critical_section_exit(&report_lock);
+    return pending;
+}
@@ -0,0 +1,82 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (C) 2025 The Whaley Group
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#ifndef _SPECTRUM_H_
+#define _SPECTRUM_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "mic_config.h"
+
+#ifndef SPECTRUM_FFT_SIZE
+#define SPECTRUM_FFT_SIZE 1024              // points per FFT, power of 2, hop is half of this
+#endif
+
+#ifndef SPECTRUM_BANDS_PER_OCTAVE
+#define SPECTRUM_BANDS_PER_OCTAVE 3         // 1 = octave bands, 3 = third-octave bands
+#endif
+
+#ifndef SPECTRUM_OCTAVES
+#define SPECTRUM_OCTAVES 8                  // octaves covered, counting down from SPECTRUM_TOP_HZ
+#endif
+
+#ifndef SPECTRUM_TOP_HZ
+#define SPECTRUM_TOP_HZ 16000               // centre frequency of the highest band
+#endif
+
+#ifndef SPECTRUM_INTERVAL_MS
+#define SPECTRUM_INTERVAL_MS 0              // averaging and report period, 0 = off, settable by HID feature report 5
+#endif
+
+#define SPECTRUM_BANDS (SPECTRUM_BANDS_PER_OCTAVE * SPECTRUM_OCTAVES)
+#define SPECTRUM_REPORT_LEN (1 + 2 * SPECTRUM_BANDS)    // sequence byte, then left bands, then right bands
+
+#if MIC_CHANNELS != 2
+#error "the spectrum packs one stereo pair into each complex FFT"
+#endif
+
+#if (SPECTRUM_FFT_SIZE & (SPECTRUM_FFT_SIZE - 1)) != 0
+#error "SPECTRUM_FFT_SIZE must be a power of 2"
+#endif
+
+extern volatile uint16_t spectrum_interval_ms;
+extern volatile uint32_t spectrum_cycles_per_block;     // worst average cost of one MIC_BLOCK_FRAMES block, cpu cycles
+
+// build the window, twiddle and band tables, call once before the other core starts
+void spectrum_init(void);
+
+// Feed one block of interleaved stereo frames.  Runs on core1; every half FFT the
+// windowed FFT is taken and band powers accumulated, and every spectrum_interval_ms
+// of audio a report is published for spectrum_take_report().
+void spectrum_add_block(const int (*block)[MIC_CHANNELS], int frames);
+
+// drop the partial FFT input and averages, e.g. after a gap in the audio
+void spectrum_reset(void);
+
+// Copy out the newest unread report (SPECTRUM_REPORT_LEN bytes).  Each level byte is
+// the band level in 0.5 dB steps below a full scale sine, 255 = -127.5 dB or less.
+bool spectrum_take_report(uint8_t* report);
+
+#endif
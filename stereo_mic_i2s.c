@@ -37,9 +37,44 @@ G. Whaley
 #include "hardware/irq.h"
 #include "hardware/clocks.h"
 #include "stereo_mic_i2s.pio.h"       // include the compiled pio program data, this line must follow the above #includes
+#include "test_pattern.h"
+#include "mic_config.h"
+#include "sample_convert.h"
+#include "trigger_input.h"
 
-#define I2S_SAMPLE_BUFFER_SIZE 48               // number of stored samples of each channel
-#define I2S_SAMPLE_RATE 48000                   //  fixed sample rate for this microphone in Hz
+#ifndef I2S_PREROLL_BLOCKS
+#if PICO_RP2350
+#define I2S_PREROLL_BLOCKS 64                   // the RP2350 has 520 kB of SRAM, so keep more history for triggers and stream start
+#else
+#define I2S_PREROLL_BLOCKS 16                   // blocks of recent audio kept in the sample ring, must be a power of 2
+#endif
+#endif
+
+#ifndef I2S_MIC_STARTUP_MS
+#define I2S_MIC_STARTUP_MS 85                   // ICS-43434 start-up: 2^18 SCK cycles at 3.072MHz before output is valid
+#endif
+
+#define I2S_STARTUP_BLOCKS ((I2S_MIC_STARTUP_MS * MIC_FRAMES_PER_MS + MIC_BLOCK_FRAMES - 1) / MIC_BLOCK_FRAMES)
+
+#ifndef TEST_SIGNAL_DEFAULT
+#define TEST_SIGNAL_DEFAULT TEST_PATTERN_OFF    // synthetic source at boot, settable by HID feature report 6
+#endif
+
+#if !TEST_PATTERN_FITS(TEST_SIGNAL_DEFAULT, MIC_WIRE_BITS)
+#error "TEST_SIGNAL_DEFAULT would be cut by the sample format: the counter needs SE_32, the sweep 17 sample bits"
+#endif
+
+#if MIC_CHANNELS != 2
+#error "the I2S program reads one stereo data line, MIC_CHANNELS other than 2 needs a TDM or multi-pin capture program"
+#endif
+
+#if (I2S_PREROLL_BLOCKS & (I2S_PREROLL_BLOCKS - 1)) != 0
+#error "I2S_PREROLL_BLOCKS must be a power of 2"
+#endif
+
+#if defined(SYS_CLK_HZ) && SYS_CLK_HZ < MIC_PIO_CLK_HZ
+#error "the system clock is too slow for the PIO clock MIC_SAMPLE_RATE needs"
+#endif
 
 struct microphone_config {                 // struct to contain hardware choices for connecting the I2S interface
     uint gpio_data;                         // GPIO pin for the I2S DAT signal
@@ -81,30 +116,79 @@ After a dma transfer is completed and an interrupt is triggered, the dma
 write address and count need updating to a new buffer location and the dma
 triggered again.
 
+Each completed block is copied into the next slot of sample_ring, which always
+holds the last I2S_PREROLL_BLOCKS blocks.  blocks_captured counts completed
+blocks since boot, so block n lives in sample_ring[n % I2S_PREROLL_BLOCKS] until
+it is overwritten I2S_PREROLL_BLOCKS blocks later.  The copy also clears the
+bits below MIC_SAMPLE_BITS (sample_convert.c), so the ring holds clean SE_32.  The consumer keeps its own
+count of blocks sent and so can start a stream from audio captured before the
+host asked for it.
+
+Capture can be stopped while no stream is open.  Stopping the PIO parks the
+clock pins low, which puts the microphones into their power down state.  After
+a restart the microphones need I2S_MIC_STARTUP_MS to settle, and blocks before
+blocks_settled should not be used as audio.
+
+With test_signal_mode set, each block is generated from test_pattern.h instead of
+copied from the dma buffer.  The PIO and dma keep running so the block timing is
+still the real sample clock, but the data no longer depends on the microphones,
+which lets the USB path and the host be qualified on their own.
+
 */
 
-int sample_buffer[I2S_SAMPLE_BUFFER_SIZE][2];                                       // left channel is index 0, right is index 1
-volatile uint sample_buffer_ready = false;
-volatile int raw_dma_buffer[I2S_SAMPLE_BUFFER_SIZE*2];                                           // storage for interleaved FIFO data
+int sample_ring[I2S_PREROLL_BLOCKS][MIC_BLOCK_FRAMES][MIC_CHANNELS];               // left channel is index 0, right is index 1
+volatile uint32_t blocks_captured = 0;                                              // completed blocks since boot
+volatile uint32_t blocks_settled = 0;                                               // first block after the mics finished starting up
+volatile int raw_dma_buffer[MIC_BLOCK_SAMPLES];                                     // storage for interleaved FIFO data
 int dma_chan;
+volatile uint8_t test_signal_mode = TEST_SIGNAL_DEFAULT;
+struct test_pattern test_signal;                                                    // generator state, dma irq only
+uint i2s_program_offset;
+bool i2s_running = false;
+
+// most recent audio for block number n, valid while n is within I2S_PREROLL_BLOCKS of blocks_captured
+static inline int (*i2s_block(uint32_t n))[MIC_CHANNELS] {
+    return sample_ring[n & (I2S_PREROLL_BLOCKS - 1)];
+}
+
+// Frame number being received now, in the block count of the sample ring.  Call with
+// interrupts off so my_dma_handler() cannot run between the two reads; a finished
+// transfer not yet handled has transfer_count 0 and counts as a full block.
+uint32_t i2s_frame_now(bool* capturing) {
+    uint32_t frame = blocks_captured * MIC_BLOCK_FRAMES;
+    *capturing = i2s_running;
+    if (i2s_running) {                                  // stopped: the partial block was discarded
+        frame += (MIC_BLOCK_SAMPLES - dma_channel_hw_addr(dma_chan)->transfer_count) / MIC_CHANNELS;
+    }
+    return frame;
+}
 
 // routine to manage the two raw data buffers into which the dma will copy raw data from the FIFO.
 // it is set to be called when the irq0 is triggered upon the dma transfer complete event.
 void my_dma_handler(){
     dma_hw->ints0 = (1u << dma_chan);                   // ack the interrupt by writing a mask to the status register
 
-    for(int i = 0; i < I2S_SAMPLE_BUFFER_SIZE; i++){          // copy interleaved raw data to sample buffer while shifting 8 bits
-        sample_buffer[i][0] = raw_dma_buffer[i*2];
-        sample_buffer[i][1] = raw_dma_buffer[i*2+1];
+    int (*block)[MIC_CHANNELS] = i2s_block(blocks_captured);
+    if (test_signal_mode != TEST_PATTERN_OFF) {
+        if (test_signal.pattern != test_signal_mode) {            // newly selected, start from frame 0
+            test_pattern_start(&test_signal, test_signal_mode, MIC_CHANNELS, 0);
+        }
+        test_pattern_fill(&test_signal, (int32_t *)block, MIC_BLOCK_FRAMES);
+    } else {
+        test_signal.pattern = TEST_PATTERN_OFF;
+        // copy interleaved raw data to the next slot of the sample ring, clearing the undefined low bits.
+        // the transfer has finished, so the buffer can be read as ordinary memory until it is restarted below
+        convert_normalize((int32_t *)block, (const int32_t *)raw_dma_buffer, MIC_BLOCK_SAMPLES);
     }
-    sample_buffer_ready = true;
-    dma_channel_transfer_to_buffer_now(dma_chan,raw_dma_buffer,I2S_SAMPLE_BUFFER_SIZE*2);   // set the dma to transfer another block, assume buffer is empty
+    blocks_captured++;
+    dma_channel_transfer_to_buffer_now(dma_chan,raw_dma_buffer,MIC_BLOCK_SAMPLES);   // set the dma to transfer another block, assume buffer is empty
 };
 
 
 void i2s_microphone_init(struct microphone_config config ) {
 
     uint pio_sm_offset = pio_add_program(config.pio, &i2s_mic_program);            // installs the pio code and returns its offset location
+    i2s_program_offset = pio_sm_offset;
 
     // init the pio with the helper function defined in the pio file
     i2s_mic_program_init(config.pio, config.pio_sm, pio_sm_offset, config.gpio_data, config.gpio_clk);
@@ -115,9 +199,9 @@ void i2s_microphone_init(struct microphone_config config ) {
     channel_config_set_transfer_data_size(&c, DMA_SIZE_32);                     // set the transfer size = 32 bits (4 bytes)
     channel_config_set_read_increment(&c, false);                               // set for no read increment
     channel_config_set_write_increment(&c,true);                                // set for write address increment after each write to dma memory
-    channel_config_set_dreq(&c, DREQ_PIO0_RX0);                                 // set for DREQ pacing on the input FIFO
+    channel_config_set_dreq(&c, pio_get_dreq(config.pio, config.pio_sm, false)); // set for DREQ pacing on the input FIFO of the chosen SM
     dma_channel_configure(dma_chan, &c, &raw_dma_buffer,
-         &config.pio->rxf[config.pio_sm], I2S_SAMPLE_BUFFER_SIZE*2, false);  // take the dma config parms and load them into hardware, false=don't start dma yet
+         &config.pio->rxf[config.pio_sm], MIC_BLOCK_SAMPLES, false);  // take the dma config parms and load them into hardware, false=don't start dma yet
 
     dma_channel_set_irq0_enabled(dma_chan, true);                               // set the dma complete to call irq0
     irq_set_exclusive_handler(DMA_IRQ_0, my_dma_handler);                       // Configure the processor to run dma_handler() when DMA IRQ 0 is asserted
@@ -126,7 +210,25 @@ void i2s_microphone_init(struct microphone_config config ) {
 
 void i2s_microphone_start(struct microphone_config config) {
     //  launches the hardware running with an initially empty buffer
-    dma_channel_transfer_to_buffer_now(dma_chan,raw_dma_buffer,I2S_SAMPLE_BUFFER_SIZE*2);   // set the dma to transfer another block, assume buffer is empty
+    if (i2s_running) return;
+    blocks_settled = blocks_captured + (test_signal_mode ? 0 : I2S_STARTUP_BLOCKS);    // mics were unclocked, their output needs time to settle
+    pio_sm_clear_fifos(config.pio, config.pio_sm);
+    pio_sm_restart(config.pio, config.pio_sm);
+    pio_sm_exec(config.pio, config.pio_sm, pio_encode_jmp(i2s_program_offset));   // begin again at the left channel entry point
+    dma_channel_transfer_to_buffer_now(dma_chan,raw_dma_buffer,MIC_BLOCK_SAMPLES);   // set the dma to transfer another block, assume buffer is empty
     dma_channel_start(dma_chan);          //  enable the dma hardware enable bit.
     pio_sm_set_enabled(config.pio,config.pio_sm,true);
+    i2s_running = true;
+};
+
+void i2s_microphone_stop(struct microphone_config config) {
+    //  stops the clocks so the microphones drop into power down, the partial block in flight is discarded
+    if (!i2s_running) return;
+    pio_sm_set_enabled(config.pio, config.pio_sm, false);
+    dma_channel_set_irq0_enabled(dma_chan, false);                          // RP2040-E13: an abort can still raise the completion irq
+    dma_channel_abort(dma_chan);
+    dma_hw->ints0 = (1u << dma_chan);
+    dma_channel_set_irq0_enabled(dma_chan, true);
+    pio_sm_set_pins_with_mask(config.pio, config.pio_sm, 0, 3u << config.gpio_clk);   // park BCLK and LRCLK low
+    i2s_running = false;
 };
\ No newline at end of file
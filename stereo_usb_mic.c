@@ -34,12 +34,24 @@
 
     Functional Specifications:
     - USB 2.0 device enumerates as a standard audio class 2.0 device.
-    - Audio sample rate is fixed at 48000 Hz.
+    - Audio sample rate, block length and wiring are set in mic_config.h
+      (48000 Hz, 1 ms blocks by default).
     - Data is encoded as PCM samples SE_32 (32 bits per sample).
     - MEMS microphones output I2S data interface.
     - Target MEMS microphone is Invensense ICS-43434, 24 bits/sample
     - Uses Raspberry Pi Pico RP2040 microcontroller.
     - USB enumeration of HID interface providing MCU temperature.
+    - HID sensor report pushed on the interrupt IN endpoint, temperature
+      sampled in the background by the free running ADC.
+    - Microphones are stopped after CAPTURE_IDLE_SLEEP_MS with no stream open.
+      While they run, a pre-roll ring of recent audio is kept so a newly
+      opened stream starts with valid samples immediately.
+    - Block energy activity detector with hysteresis, reported in the HID
+      status byte, optionally gating the stream to silence between sounds.
+    - Octave or third-octave band levels of both channels computed on core1
+      and pushed as a HID report, for monitoring without the audio stream.
+    - Synthetic counter and sweep test signals in place of the microphones,
+      checked on the host by host/stream_verify.
 
     Codebase uses the TinyUSB library.  Note the version of Tinyusb supplied
     with the Pico SDK has an endpoint buffer bug, which has been fixed in
@@ -49,46 +61,224 @@
 
 
 #include <stdio.h>
+#include <string.h>
 #include "pico/stdlib.h"
+#include "pico/multicore.h"
 #include "stereo_mic_i2s.c"
 #include "usb_mic_callbacks.h"
-#include "hardware/adc.h"
+#include "activity_detector.h"
+#include "spectrum.h"
+#include "sample_convert.h"
 #include "bsp/board_api.h"
 
 
 const struct microphone_config mic_config = {
-    .gpio_data = 2,                         // GPIO pin for the I2S DAT signal
-    .gpio_clk = 3,                          // GPIO pin for the I2S CLK signal
-    .pio = pio0,                            // PIO instance to use
-    .pio_sm = 0,                            // PIO State Machine instance to use
+    .gpio_data = MIC_GPIO_DATA,             // GPIO pin for the I2S DAT signal
+    .gpio_clk = MIC_GPIO_CLK,               // GPIO pin for the I2S CLK signal
+    .pio = MIC_PIO,                         // PIO instance to use
+    .pio_sm = MIC_PIO_SM,                   // PIO State Machine instance to use
 };
 
-int decimate = 0;
+#ifndef CAPTURE_IDLE_SLEEP_MS
+#define CAPTURE_IDLE_SLEEP_MS 10000             // stop the mics this long after the last stream closed, 0 = never
+#endif
 
+#ifndef CAPTURE_PREROLL_SEND_BLOCKS
+#define CAPTURE_PREROLL_SEND_BLOCKS 2           // blocks of history queued to the host the moment a stream opens
+#endif
 
-int main()
-{
+#if CAPTURE_PREROLL_SEND_BLOCKS >= I2S_PREROLL_BLOCKS
+#error "CAPTURE_PREROLL_SEND_BLOCKS must be smaller than I2S_PREROLL_BLOCKS"
+#endif
+
+#if ACTIVITY_PRETRIGGER_BLOCKS + 2 > I2S_PREROLL_BLOCKS
+#error "the sample ring must hold the activity gate pre-trigger history"
+#endif
+
+/*
+Capture power states:
+    CAPTURE_STREAMING   host has the stream open, every captured block is sent.
+    CAPTURE_PREROLL     no stream, but the mics keep running into the sample ring so
+                        a stream opened now starts from already settled audio.  The
+                        cpu sleeps between interrupts.
+    CAPTURE_SLEEP       no stream for CAPTURE_IDLE_SLEEP_MS, PIO and dma stopped and the
+                        mic clocks parked.  Opening a stream restarts the mics; until
+                        they settle the host receives silence rather than start-up noise.
+*/
+enum capture_state { CAPTURE_SLEEP, CAPTURE_PREROLL, CAPTURE_STREAMING };
+
+volatile enum capture_state capture_state = CAPTURE_PREROLL;
+uint32_t blocks_sent;                                   // next block number to hand to the USB fifo
+uint32_t stream_first_frame;                            // capture frame number of the first frame of the open stream
+volatile uint32_t stream_epoch;                         // bumped when stream_first_frame or the open stream changes
+uint32_t blocks_analysed;                               // next block number for the activity detector
+uint32_t blocks_spectrum;                               // next block number for the core1 spectrum, core1 only
+uint32_t idle_since_ms;
+
+
+void analyse_pending_blocks() {
+    uint32_t captured = blocks_captured;
+    if (captured - blocks_analysed >= I2S_PREROLL_BLOCKS) {
+        blocks_analysed = captured - (I2S_PREROLL_BLOCKS - 1);
+    }
+    while (blocks_analysed != captured) {
+        if ((int32_t)(blocks_analysed - blocks_settled) >= 0) {     // startup blocks would look like an onset
+            activity_detector_update(blocks_analysed, (const int (*)[MIC_CHANNELS])i2s_block(blocks_analysed), MIC_BLOCK_FRAMES);
+        }
+        blocks_analysed++;
+    }
+}
+
+// core1 follows the sample ring independently of the USB side and only reads it
+void core1_spectrum_main() {
+    while (true) {
+        uint32_t captured = blocks_captured;
+        if (spectrum_interval_ms == 0 || blocks_spectrum == captured) {
+            if (spectrum_interval_ms == 0) blocks_spectrum = captured;
+            sleep_us(500);                              // a block arrives every 1 ms
+            continue;
+        }
+        if (captured - blocks_spectrum >= I2S_PREROLL_BLOCKS) {     // fell behind or capture restarted
+            blocks_spectrum = captured - (I2S_PREROLL_BLOCKS - 1);
+            spectrum_reset();
+        }
+        if ((int32_t)(blocks_spectrum - blocks_settled) >= 0) {
+            spectrum_add_block((const int (*)[MIC_CHANNELS])i2s_block(blocks_spectrum), MIC_BLOCK_FRAMES);
+        } else {
+            spectrum_reset();                           // mics starting up, begin again once settled
+        }
+        blocks_spectrum++;
+    }
+}
+
+// The ring keeps unscaled 32 bit words.  Mute and volume are applied on the way out,
+// except to a test signal which must arrive bit exact (master mute still silences
+// it), and narrower USB formats are converted last.  The output goes straight into
+// the USB fifo, so at unity gain each sample is read from the ring once and written
+// once.  Returns false, leaving the block in the ring, while the fifo is full.
+static bool write_block(const int (*block)[MIC_CHANNELS]) {
+    const int32_t* samples = (const int32_t *)block;
+    if (test_signal_mode != TEST_PATTERN_OFF && mic_mute[0]) {
+        return usb_microphone_write_silence(MIC_BLOCK_BYTES);
+    }
+    void* dst = usb_microphone_write_begin(MIC_BLOCK_BYTES);
+    if (dst == NULL) return false;
+#if MIC_BYTES_PER_SAMPLE == 4
+    if (test_signal_mode != TEST_PATTERN_OFF || !mic_gain_apply((int32_t *)dst, samples, MIC_BLOCK_FRAMES)) {
+        memcpy(dst, samples, MIC_BLOCK_BYTES);
+    }
+#else
+    static int32_t scaled[MIC_BLOCK_SAMPLES];
+    if (test_signal_mode == TEST_PATTERN_OFF && mic_gain_apply(scaled, samples, MIC_BLOCK_FRAMES)) {
+        samples = scaled;
+    }
+#if MIC_BYTES_PER_SAMPLE == 3
+    convert_to_s24((uint8_t *)dst, samples, MIC_BLOCK_SAMPLES);
+#else
+    convert_to_s16((int16_t *)dst, samples, MIC_BLOCK_SAMPLES);
+#endif
+#endif
+    usb_microphone_write_commit(MIC_BLOCK_BYTES);
+    return true;
+}
+
+void send_pending_blocks() {
+    uint32_t captured = blocks_captured;
+    if (captured - blocks_sent >= I2S_PREROLL_BLOCKS) {         // fell a whole ring behind, skip to the oldest intact block
+        uint32_t skipped = captured - (I2S_PREROLL_BLOCKS - 1) - blocks_sent;
+        stream_first_frame += skipped * MIC_BLOCK_FRAMES;      // the host never sees them, keep trigger stream frames aligned
+        stream_epoch++;                                         // edges before the skip cannot be placed with one offset
+        blocks_sent += skipped;
+    }
+    // with the gate on, hold back far enough that an onset can still open the gate for earlier blocks
+    uint32_t ready = activity_gate_enabled ? blocks_analysed - ACTIVITY_PRETRIGGER_BLOCKS : captured;
+    while ((int32_t)(ready - blocks_sent) > 0) {
+        bool written;
+        if ((int32_t)(blocks_sent - blocks_settled) < 0 || !activity_gate_pass(blocks_sent)) {
+            written = usb_microphone_write_silence(MIC_BLOCK_BYTES);    // mics still starting up, or gated silence
+        } else {
+            written = write_block(i2s_block(blocks_sent));         // Write ring block to the USB microphone
+                                                                        // block is array of interleaved 32bit ints.
+        }
+        if (!written) break;                                    // USB fifo full, the ring holds the rest until the host catches up
+        blocks_sent++;
+    }
+}
+
+// called by the audio class callbacks inside tud_task()
+void usb_microphone_stream_cb(bool open) {
+    if (open) {
+        if (capture_state == CAPTURE_STREAMING) return;        // alt setting re-selected, keep the stream continuous
+        if (capture_state == CAPTURE_SLEEP) {
+            i2s_microphone_start(mic_config);
+            blocks_sent = blocks_captured;
+        } else {
+            blocks_sent = blocks_captured - CAPTURE_PREROLL_SEND_BLOCKS;   // start with audio from just before the open
+        }
+        stream_first_frame = blocks_sent * MIC_BLOCK_FRAMES;
+        stream_epoch++;
+        capture_state = CAPTURE_STREAMING;
+        analyse_pending_blocks();
+        send_pending_blocks();                                  // first packet carries valid samples immediately
+    } else if (capture_state == CAPTURE_STREAMING) {
+        stream_epoch++;
+        capture_state = CAPTURE_PREROLL;
+        idle_since_ms = to_ms_since_boot(get_absolute_time());
+    }
+}
+
+
+// everything main() sets up before the loop
+void capture_init() {
     stdio_init_all();                                   //  supports standard uart output for printf.
+#if SAMPLE_CONVERT_BENCHMARK
+    sample_convert_benchmark();                         // before anything else takes interrupts
+#endif
     i2s_microphone_init(mic_config);
     i2s_microphone_start(mic_config);
     usb_microphone_init();                              // contains tusb_init()
 
-    adc_init();
-    adc_select_input(4);                                //  chan 4 is the internal temperature sensor
-    adc_set_temp_sensor_enabled(true);                  // activate the internal pullup resistor to bias temp sensor
+    trigger_input_init();                               // edges timestamped from the dma position
+    temp_sensor_init();                                 // free running ADC averaged by dma, read by the HID task
+    activity_detector_init();
+    spectrum_init();                                    // tables, then hand the analysis to core1
+    multicore_launch_core1(core1_spectrum_main);
     board_init();
     board_led_write(1);                                 // turn on LED for USB power indicator
 
+    idle_since_ms = to_ms_since_boot(get_absolute_time());
+}
+
+// One pass of the main loop.  Kept apart from main() so host/soak can run the same
+// code against simulated PIO, dma and USB timing.
+void capture_poll() {
+    tud_task();                                         // spend most time here polling for usb tasks
+    analyse_pending_blocks();                           // runs with or without a stream so the host can be woken
+    usb_hid_task();                                     // push the sensor report when due
 
+    if (capture_state == CAPTURE_STREAMING) {
+        send_pending_blocks();                          // blocks_captured changes in the background and is volatile
+        return;
+    }
+
+    if (capture_state == CAPTURE_PREROLL && CAPTURE_IDLE_SLEEP_MS != 0 && spectrum_interval_ms == 0 &&
+        to_ms_since_boot(get_absolute_time()) - idle_since_ms >= CAPTURE_IDLE_SLEEP_MS) {
+        i2s_microphone_stop(mic_config);
+        capture_state = CAPTURE_SLEEP;
+    }
+    if (capture_state == CAPTURE_SLEEP && spectrum_interval_ms != 0) {     // spectrum turned on over HID
+        i2s_microphone_start(mic_config);
+        capture_state = CAPTURE_PREROLL;
+    }
+    best_effort_wfe_or_timeout(make_timeout_time_ms(1));        // sleep until the next usb or dma interrupt, at most 1 ms
+}
+
+#ifndef CAPTURE_NO_MAIN
+int main()
+{
+    capture_init();
     while (true) {
-        while (sample_buffer_ready == 0) {     // sample_buffer_ready changes in the background and is volatile
-            tud_task();                         // spend most time here polling for usb tasks
-        }  
-                                                                    //  at this point we have a i2s buffer full to process    
-        usb_microphone_write(sample_buffer, sizeof(sample_buffer));  // Write local buffer to the USB microphone
-                                                                    // sample_buffer is array of interleaved 32bit ints.
-                                                                    // size is number of bytes.
-        sample_buffer_ready = false;
+        capture_poll();
     }
 };
-
+#endif
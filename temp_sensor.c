@@ -0,0 +1,89 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (C) 2025 The Whaley Group
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+/*
+Background sampling of the RP2040 or RP2350 internal temperature sensor.
+
+The ADC runs free on the temperature input at TEMP_SENSOR_SAMPLE_RATE and each conversion is
+pushed through the ADC FIFO.  A dma channel moves the 16 bit results into a small
+ring buffer; the write address wraps on the buffer size (CTRL.RING_SEL=write) so
+the ring always holds the most recent TEMP_SENSOR_AVG_SAMPLES conversions and the
+cpu never services the ADC.  A reading is the average of the whole ring, which
+smooths the +-1 LSB noise of the sensor (about 0.5 degC per LSB) into a steady
+value for speed of sound compensation.
+*/
+
+#include "pico/stdlib.h"
+#include "hardware/adc.h"
+#include "hardware/dma.h"
+#include "temp_sensor.h"
+
+#define TEMP_SENSOR_ADC_INPUT ADC_TEMPERATURE_CHANNEL_NUM   // the last input, 4 on the RP2040 and RP2350A, 8 on the RP2350B
+#define TEMP_SENSOR_RING_BYTES (TEMP_SENSOR_AVG_SAMPLES * 2)
+
+static volatile uint16_t adc_ring[TEMP_SENSOR_AVG_SAMPLES] __attribute__((aligned(TEMP_SENSOR_RING_BYTES)));   // ring wrap needs natural alignment
+static int adc_dma_chan;
+
+static uint ring_size_bits(uint bytes) {
+    uint bits = 0;
+    while ((1u << bits) < bytes) bits++;
+    return bits;
+}
+
+void temp_sensor_init(void) {
+    adc_init();
+    adc_set_temp_sensor_enabled(true);                  // activate the internal pullup resistor to bias temp sensor
+    adc_select_input(TEMP_SENSOR_ADC_INPUT);
+
+    // prime the ring with one blocking conversion so the first readings are sane
+    uint16_t first = adc_read();
+    for (int i = 0; i < TEMP_SENSOR_AVG_SAMPLES; i++) adc_ring[i] = first;
+
+    adc_fifo_setup(true, true, 1, false, false);        // FIFO on, DREQ at 1 sample, no error bit, keep 12 bits
+    adc_fifo_drain();
+    adc_set_clkdiv(48000000.0f / TEMP_SENSOR_SAMPLE_RATE - 1.0f);     // ADC clock is 48MHz, one conversion per (div+1) cycles
+
+    adc_dma_chan = dma_claim_unused_channel(true);
+    dma_channel_config c = dma_channel_get_default_config(adc_dma_chan);
+    channel_config_set_transfer_data_size(&c, DMA_SIZE_16);
+    channel_config_set_read_increment(&c, false);                           // fixed on the ADC FIFO
+    channel_config_set_write_increment(&c, true);
+    channel_config_set_ring(&c, true, ring_size_bits(TEMP_SENSOR_RING_BYTES));   // wrap the write address on the ring
+    channel_config_set_dreq(&c, DREQ_ADC);
+    dma_channel_configure(adc_dma_chan, &c, (void *)adc_ring, &adc_hw->fifo, 0xFFFFFFFF, true);   // ~49 days at 1kHz before re-arm
+
+    adc_run(true);
+}
+
+int16_t temp_sensor_read(void) {
+    if (!dma_channel_is_busy(adc_dma_chan)) {                               // transfer count finally ran out, start it again
+        dma_channel_set_trans_count(adc_dma_chan, 0xFFFFFFFF, true);
+    }
+
+    uint32_t sum = 0;
+    for (int i = 0; i < TEMP_SENSOR_AVG_SAMPLES; i++) sum += adc_ring[i];   // a conversion landing mid-sum only shifts the window
+    float volts = (float)sum * (3.00f / 4096.0f) / TEMP_SENSOR_AVG_SAMPLES;
+    return (int16_t)(100.0f * (27.0f - (volts - 0.706f) * 581.0f));          // convert adc reading to degrees C * 100
+}
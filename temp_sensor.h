@@ -0,0 +1,42 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (C) 2025 The Whaley Group
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#ifndef _TEMP_SENSOR_H_
+#define _TEMP_SENSOR_H_
+
+#include <stdint.h>
+
+#ifndef TEMP_SENSOR_SAMPLE_RATE
+#define TEMP_SENSOR_SAMPLE_RATE 1000            // ADC conversions per second, free running in the background
+#endif
+
+#ifndef TEMP_SENSOR_AVG_SAMPLES
+#define TEMP_SENSOR_AVG_SAMPLES 64              // conversions averaged per reading, must be a power of 2
+#endif
+
+void temp_sensor_init(void);                    // starts the free running ADC and its DMA channel
+int16_t temp_sensor_read(void);                 // averaged temperature in degrees C * 100, never blocks
+
+#endif
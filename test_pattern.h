@@ -0,0 +1,170 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (C) 2025 The Whaley Group
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+/*
+Deterministic test patterns that stand in for the microphones.
+
+This header is shared by the firmware, which generates the patterns in place of
+the I2S data, and the host stream_verify tool, which regenerates them to check
+the received stream bit for bit.  Everything is integer arithmetic so both ends
+produce identical samples.
+
+  TEST_PATTERN_COUNTER  bits 31-8 hold the frame number (mod 2^24), bits 7-0 the
+                        channel number.  A gap or repeat shows its exact size.
+  TEST_PATTERN_SWEEP    a linear sine sweep at -6 dBFS repeating every
+                        TEST_PATTERN_SWEEP_FRAMES, with channel c delayed by
+                        c * TEST_PATTERN_DELAY_FRAMES, so beamforming and delay
+                        estimation can be checked against a known answer.
+*/
+
+#ifndef _TEST_PATTERN_H_
+#define _TEST_PATTERN_H_
+
+#include <stdint.h>
+
+#define TEST_PATTERN_OFF        0
+#define TEST_PATTERN_COUNTER    1
+#define TEST_PATTERN_SWEEP      2
+
+// True when the pattern reaches the host bit for bit through a format that carries
+// the leading `bits` of each word.  The counter keeps the channel in bits 7-0, and
+// the sweep has 17 significant bits.
+#define TEST_PATTERN_FITS(pattern, bits) ((pattern) == TEST_PATTERN_OFF || \
+                                          ((pattern) == TEST_PATTERN_COUNTER && (bits) >= 32) || \
+                                          ((pattern) == TEST_PATTERN_SWEEP && (bits) >= 17))
+
+#ifndef TEST_PATTERN_RATE
+#define TEST_PATTERN_RATE 48000                 // sample rate the sweep frequencies refer to
+#endif
+
+#ifndef TEST_PATTERN_SWEEP_FRAMES
+#define TEST_PATTERN_SWEEP_FRAMES 48000         // sweep length, it then starts again
+#endif
+
+#ifndef TEST_PATTERN_SWEEP_START_HZ
+#define TEST_PATTERN_SWEEP_START_HZ 100
+#endif
+
+#ifndef TEST_PATTERN_SWEEP_STOP_HZ
+#define TEST_PATTERN_SWEEP_STOP_HZ 20000
+#endif
+
+#ifndef TEST_PATTERN_DELAY_FRAMES
+#define TEST_PATTERN_DELAY_FRAMES 7             // sweep delay of each channel against the one before it
+#endif
+
+#ifndef TEST_PATTERN_MAX_CHANNELS
+#define TEST_PATTERN_MAX_CHANNELS 16
+#endif
+
+// sweep phase and its per frame increment, in 2^-40 cycles
+#define TEST_PATTERN_FREQ0 (((uint64_t)TEST_PATTERN_SWEEP_START_HZ << 40) / TEST_PATTERN_RATE)
+#define TEST_PATTERN_CHIRP ((((uint64_t)(TEST_PATTERN_SWEEP_STOP_HZ - TEST_PATTERN_SWEEP_START_HZ)) << 40) / \
+                            ((uint64_t)TEST_PATTERN_RATE * TEST_PATTERN_SWEEP_FRAMES))
+
+struct test_pattern {
+    int pattern;
+    int channels;
+    uint64_t frame;                                     // number of the next frame generated
+    uint32_t index[TEST_PATTERN_MAX_CHANNELS];          // sweep position of each channel
+    uint64_t phase[TEST_PATTERN_MAX_CHANNELS];
+    uint64_t freq[TEST_PATTERN_MAX_CHANNELS];
+};
+
+// sin(2 pi phase / 2^32) at -6 dBFS in SE_32 format, 16 bit accurate, 32 bit integer only
+static inline int32_t test_pattern_sine(uint32_t phase) {
+    int32_t x = (int32_t)((phase >> 15) & 0x7FFF);          // position in the quarter cycle, Q15
+    if (phase & 0x40000000u) x = 32768 - x;
+    int32_t x2 = (x * x) >> 15;
+    int32_t p = 153;                                        // sin(pi x / 2) odd polynomial, Q15
+    p = 2611 - ((p * x2) >> 15);
+    p = 21167 - ((p * x2) >> 15);
+    p = 51472 - ((p * x2) >> 15);
+    int32_t s = (p * x) >> 15;
+    return (phase & 0x80000000u) ? -(s << 15) : (s << 15);
+}
+
+// sweep sample at position index of the sweep, closed form of test_pattern_fill()
+static inline int32_t test_pattern_sweep_at(uint32_t index) {
+    uint64_t m = index;
+    uint64_t phase = TEST_PATTERN_FREQ0 * m + TEST_PATTERN_CHIRP * (m * (m - 1) / 2);
+    return test_pattern_sine((uint32_t)(phase >> 8));
+}
+
+static inline uint32_t test_pattern_sweep_index(uint64_t frame, int channel) {
+    uint32_t m = (uint32_t)(frame % TEST_PATTERN_SWEEP_FRAMES);
+    uint32_t d = (uint32_t)(((uint64_t)channel * TEST_PATTERN_DELAY_FRAMES) % TEST_PATTERN_SWEEP_FRAMES);
+    return m >= d ? m - d : m + TEST_PATTERN_SWEEP_FRAMES - d;
+}
+
+// one sample of a pattern, slow but needs no state
+static inline int32_t test_pattern_sample(int pattern, uint64_t frame, int channel) {
+    if (pattern == TEST_PATTERN_COUNTER) return (int32_t)(((uint32_t)frame << 8) | (uint32_t)(channel & 0xFF));
+    if (pattern == TEST_PATTERN_SWEEP) return test_pattern_sweep_at(test_pattern_sweep_index(frame, channel));
+    return 0;
+}
+
+static inline void test_pattern_start(struct test_pattern* t, int pattern, int channels, uint64_t frame) {
+    t->pattern = pattern;
+    t->channels = channels < TEST_PATTERN_MAX_CHANNELS ? channels : TEST_PATTERN_MAX_CHANNELS;
+    t->frame = frame;
+    for (int c = 0; c < t->channels; c++) {
+        uint64_t m = test_pattern_sweep_index(frame, c);
+        t->index[c] = (uint32_t)m;
+        t->phase[c] = TEST_PATTERN_FREQ0 * m + TEST_PATTERN_CHIRP * (m * (m - 1) / 2);
+        t->freq[c] = TEST_PATTERN_FREQ0 + TEST_PATTERN_CHIRP * m;
+    }
+}
+
+// Generate the next frames into an interleaved buffer.  The sweep is stepped with
+// 64 bit adds only, which the M0+ manages in a dma interrupt.
+static inline void test_pattern_fill(struct test_pattern* t, int32_t* interleaved, int frames) {
+    int channels = t->channels;
+    if (t->pattern == TEST_PATTERN_COUNTER) {
+        uint32_t word = (uint32_t)t->frame << 8;
+        for (int i = 0; i < frames; i++, word += 256) {
+            for (int c = 0; c < channels; c++) *interleaved++ = (int32_t)(word | (uint32_t)c);
+        }
+    } else if (t->pattern == TEST_PATTERN_SWEEP) {
+        for (int i = 0; i < frames; i++) {
+            for (int c = 0; c < channels; c++) {
+                *interleaved++ = test_pattern_sine((uint32_t)(t->phase[c] >> 8));
+                if (++t->index[c] == TEST_PATTERN_SWEEP_FRAMES) {
+                    t->index[c] = 0;
+                    t->phase[c] = 0;
+                    t->freq[c] = TEST_PATTERN_FREQ0;
+                } else {
+                    t->phase[c] += t->freq[c];
+                    t->freq[c] += TEST_PATTERN_CHIRP;
+                }
+            }
+        }
+    } else {
+        for (int i = 0; i < frames * channels; i++) *interleaved++ = 0;
+    }
+    t->frame += (uint64_t)frames;
+}
+
+#endif
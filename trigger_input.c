@@ -0,0 +1,117 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (C) 2025 The Whaley Group
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+/*
+Trigger inputs timestamped in the capture time base.
+
+Each edge on a trigger pin raises the GPIO interrupt, which reads the capture
+frame number from the dma: completed blocks times the block length plus the
+frames already transferred into the block in flight.  With interrupts off for the
+two reads the dma interrupt cannot advance the block count in between, and a
+block that has completed but not yet been handled reads as a full block, so the
+number is consistent either way.  The edge is placed within about one frame
+(20.8 us at 48 kHz) of the audio, the interrupt latency and the sample still being
+shifted in by the PIO.
+
+Frame numbers count every captured frame since boot and wrap at 2^32 (about a
+day at 48 kHz).  The HID task sends each edge as input report 7, adding the frame
+number within the open stream so the host can index its own samples directly.
+The stream frame is only sent while the stream the edge fell in is still open and
+numbered the same way: each edge carries the stream_epoch it saw, and an edge
+queued before the stream closed, reopened or skipped blocks is reported with its
+capture frame alone.
+A pulse shorter than the interrupt latency shows both edges latched at once and is
+queued as two events with the same frame.
+*/
+
+#include "hardware/gpio.h"
+#include "hardware/sync.h"
+#include "trigger_input.h"
+
+static struct trigger_event queue[TRIGGER_QUEUE_LEN];
+static volatile uint32_t queue_head;        // written by the gpio irq
+static volatile uint32_t queue_tail;        // written by the HID task
+static bool queue_lost;                     // gpio irq only
+
+static void queue_push(uint32_t frame, uint32_t epoch, uint8_t input, uint8_t flags) {
+    uint32_t head = queue_head;
+    if (head - queue_tail >= TRIGGER_QUEUE_LEN) {
+        queue_lost = true;
+        return;
+    }
+    if (queue_lost) flags |= TRIGGER_FLAG_LOST;
+    queue_lost = false;
+    struct trigger_event* e = &queue[head & (TRIGGER_QUEUE_LEN - 1)];
+    e->frame = frame;
+    e->stream_epoch = epoch;
+    e->input = input;
+    e->flags = flags;
+    __compiler_memory_barrier();                            // entry complete before it is published
+    queue_head = head + 1;
+}
+
+static void trigger_irq(uint gpio, uint32_t events) {
+    if (!TRIGGER_USES_GPIO(gpio)) return;
+    bool capturing;
+    uint32_t irq = save_and_disable_interrupts();
+    uint32_t frame = i2s_frame_now(&capturing);
+    uint32_t epoch = stream_epoch;
+    restore_interrupts(irq);
+
+    uint8_t input = (uint8_t)(gpio - TRIGGER_GPIO_BASE);
+    uint8_t flags = capturing ? TRIGGER_FLAG_CAPTURING : 0;
+    bool rise = events & GPIO_IRQ_EDGE_RISE, fall = events & GPIO_IRQ_EDGE_FALL;
+    if (rise && fall) {                                     // both latched, the present level came last
+        bool high = gpio_get(gpio);
+        queue_push(frame, epoch, input, flags | (high ? 0 : TRIGGER_FLAG_RISING));
+        queue_push(frame, epoch, input, flags | (high ? TRIGGER_FLAG_RISING : 0));
+    } else if (rise || fall) {
+        queue_push(frame, epoch, input, flags | (rise ? TRIGGER_FLAG_RISING : 0));
+    }
+}
+
+void trigger_input_init(void) {
+    queue_head = queue_tail = 0;
+    queue_lost = false;
+    for (uint i = 0; i < TRIGGER_COUNT; i++) {
+        uint pin = TRIGGER_GPIO_BASE + i;
+        gpio_init(pin);
+        gpio_set_dir(pin, GPIO_IN);
+        gpio_pull_down(pin);
+        gpio_set_irq_enabled_with_callback(pin, GPIO_IRQ_EDGE_RISE | GPIO_IRQ_EDGE_FALL, true, trigger_irq);
+    }
+}
+
+bool trigger_input_peek(struct trigger_event* event) {
+    uint32_t tail = queue_tail;
+    if (tail == queue_head) return false;
+    __compiler_memory_barrier();
+    *event = queue[tail & (TRIGGER_QUEUE_LEN - 1)];
+    return true;
+}
+
+void trigger_input_pop(void) {
+    if (queue_tail != queue_head) queue_tail = queue_tail + 1;
+}
@@ -0,0 +1,87 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (C) 2025 The Whaley Group
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#ifndef _TRIGGER_INPUT_H_
+#define _TRIGGER_INPUT_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "mic_config.h"
+
+#ifndef TRIGGER_COUNT
+#define TRIGGER_COUNT 1                     // trigger inputs on consecutive pins, 0 = none
+#endif
+
+#ifndef TRIGGER_GPIO_BASE
+#define TRIGGER_GPIO_BASE 6                 // first trigger input, pulled down so an open input stays quiet
+#endif
+// RP2350-E9: the internal pull-down cannot hold an undriven input low on the RP2350,
+// so fit an external pull-down (about 8k2) on any trigger input that can be left open.
+
+#ifndef TRIGGER_QUEUE_LEN
+#define TRIGGER_QUEUE_LEN 16                // edges waiting for the HID task, must be a power of 2
+#endif
+
+#define TRIGGER_REPORT_LEN 10               // input, flags, capture frame, stream frame
+
+#define TRIGGER_FLAG_RISING     0x01        // level after the edge
+#define TRIGGER_FLAG_CAPTURING  0x02        // mics were running, the frame number is exact
+#define TRIGGER_FLAG_STREAM     0x04        // the stream frame is valid
+#define TRIGGER_FLAG_LOST       0x08        // the queue overflowed before this edge
+
+#define TRIGGER_USES_GPIO(p) (TRIGGER_COUNT > 0 && (p) >= TRIGGER_GPIO_BASE && (p) < TRIGGER_GPIO_BASE + TRIGGER_COUNT)
+
+#if TRIGGER_USES_GPIO(MIC_GPIO_DATA) || TRIGGER_USES_GPIO(MIC_GPIO_CLK) || TRIGGER_USES_GPIO(MIC_GPIO_CLK + 1)
+#error "the trigger inputs overlap the I2S pins"
+#endif
+
+#if (TRIGGER_QUEUE_LEN & (TRIGGER_QUEUE_LEN - 1)) != 0
+#error "TRIGGER_QUEUE_LEN must be a power of 2"
+#endif
+
+struct trigger_event {
+    uint32_t frame;                         // capture frame number of the edge, see i2s_frame_now()
+    uint32_t stream_epoch;                  // stream_epoch at the edge
+    uint8_t input;                          // 0 is TRIGGER_GPIO_BASE
+    uint8_t flags;                          // TRIGGER_FLAG_*
+};
+
+// Implemented by the capture code.  Number of the frame the I2S is receiving now,
+// counted since boot in the same blocks as the sample ring; capturing is false while
+// the mics are stopped, the frame is then the one capture will resume at.
+uint32_t i2s_frame_now(bool* capturing);
+
+// Implemented by the capture code.  Changes whenever the stream frame numbering does:
+// when the stream opens or closes, and when blocks are skipped.  An edge keeps its
+// stream frame only while this is unchanged.
+extern volatile uint32_t stream_epoch;
+
+void trigger_input_init(void);
+
+// oldest queued edge, left in the queue until trigger_input_pop()
+bool trigger_input_peek(struct trigger_event* event);
+void trigger_input_pop(void);
+
+#endif
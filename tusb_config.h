@@ -26,6 +26,8 @@
 #ifndef _TUSB_CONFIG_H_
 #define _TUSB_CONFIG_H_
 
+#include "mic_config.h"                   // audio format, the audio settings below are derived from it
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -94,23 +96,51 @@ extern "C" {
 
 // Have a look into audio_device.h for all configurations
 // The stereo microphone has one audio function so we populate values for FUNC_1
-// We need to define the size of the function 1 descriptor and the descriptor itself for two 
-// microphone channels.  TUSB only has prototype definitions for 1 and 4 channels, 
-// so the 2 channel definitions are here.
+// We need to define the size of the function 1 descriptor and the descriptor itself for
+// MIC_CHANNELS microphone channels.  TUSB only has prototype definitions for 1 and 4
+// channels, so the definitions are here.  The feature unit carries mute and volume for
+// the master and for every channel; the preprocessor cannot loop, so the per channel
+// controls are spelled out up to 16 channels and picked by MIC_CHANNELS, which must be
+// a plain number.
+
+#define TUD_AUDIO_FEATURE_UNIT_MUTE_VOLUME ((AUDIO20_CTRL_RW << AUDIO20_FEATURE_UNIT_CTRL_MUTE_POS) | (AUDIO20_CTRL_RW << AUDIO20_FEATURE_UNIT_CTRL_VOLUME_POS))   // controls of the master and each channel
+#define TUD_AUDIO_FU_CTRL U32_TO_U8S_LE(TUD_AUDIO_FEATURE_UNIT_MUTE_VOLUME)
+#define TUD_AUDIO_FU_CTRLS_1  TUD_AUDIO_FU_CTRL
+#define TUD_AUDIO_FU_CTRLS_2  TUD_AUDIO_FU_CTRLS_1, TUD_AUDIO_FU_CTRL
+#define TUD_AUDIO_FU_CTRLS_3  TUD_AUDIO_FU_CTRLS_2, TUD_AUDIO_FU_CTRL
+#define TUD_AUDIO_FU_CTRLS_4  TUD_AUDIO_FU_CTRLS_3, TUD_AUDIO_FU_CTRL
+#define TUD_AUDIO_FU_CTRLS_5  TUD_AUDIO_FU_CTRLS_4, TUD_AUDIO_FU_CTRL
+#define TUD_AUDIO_FU_CTRLS_6  TUD_AUDIO_FU_CTRLS_5, TUD_AUDIO_FU_CTRL
+#define TUD_AUDIO_FU_CTRLS_7  TUD_AUDIO_FU_CTRLS_6, TUD_AUDIO_FU_CTRL
+#define TUD_AUDIO_FU_CTRLS_8  TUD_AUDIO_FU_CTRLS_7, TUD_AUDIO_FU_CTRL
+#define TUD_AUDIO_FU_CTRLS_9  TUD_AUDIO_FU_CTRLS_8, TUD_AUDIO_FU_CTRL
+#define TUD_AUDIO_FU_CTRLS_10 TUD_AUDIO_FU_CTRLS_9, TUD_AUDIO_FU_CTRL
+#define TUD_AUDIO_FU_CTRLS_11 TUD_AUDIO_FU_CTRLS_10, TUD_AUDIO_FU_CTRL
+#define TUD_AUDIO_FU_CTRLS_12 TUD_AUDIO_FU_CTRLS_11, TUD_AUDIO_FU_CTRL
+#define TUD_AUDIO_FU_CTRLS_13 TUD_AUDIO_FU_CTRLS_12, TUD_AUDIO_FU_CTRL
+#define TUD_AUDIO_FU_CTRLS_14 TUD_AUDIO_FU_CTRLS_13, TUD_AUDIO_FU_CTRL
+#define TUD_AUDIO_FU_CTRLS_15 TUD_AUDIO_FU_CTRLS_14, TUD_AUDIO_FU_CTRL
+#define TUD_AUDIO_FU_CTRLS_16 TUD_AUDIO_FU_CTRLS_15, TUD_AUDIO_FU_CTRL
+#define TUD_AUDIO_FU_CTRLS_CAT(n) TUD_AUDIO_FU_CTRLS_##n
+#define TUD_AUDIO_FU_CTRLS(n) TUD_AUDIO_FU_CTRLS_CAT(n)
+
+#if MIC_CHANNELS < 1 || MIC_CHANNELS > 16
+#error "the feature unit descriptor is spelled out for 1 to 16 channels"
+#endif
 
-#define TUD_AUDIO_DESC_FEATURE_UNIT_TWO_CHANNEL_MUTEONLY_LEN (6+(2+1)*4)
-#define TUD_AUDIO_DESC_FEATURE_UNIT_TWO_CHANNEL_MUTEONLY(_unitid, _srcid, _ctrlch0master, _ctrlch1, _ctrlch2, _stridx) \
-		TUD_AUDIO_DESC_FEATURE_UNIT_TWO_CHANNEL_MUTEONLY_LEN, TUSB_DESC_CS_INTERFACE, AUDIO20_CS_AC_INTERFACE_FEATURE_UNIT, _unitid, _srcid, U32_TO_U8S_LE(_ctrlch0master), U32_TO_U8S_LE(_ctrlch1), U32_TO_U8S_LE(_ctrlch2), _stridx
+#define TUD_AUDIO_DESC_FEATURE_UNIT_MIC_LEN (6+(MIC_CHANNELS+1)*4)
+#define TUD_AUDIO_DESC_FEATURE_UNIT_MIC(_unitid, _srcid, _stridx) \
+		TUD_AUDIO_DESC_FEATURE_UNIT_MIC_LEN, TUSB_DESC_CS_INTERFACE, AUDIO20_CS_AC_INTERFACE_FEATURE_UNIT, _unitid, _srcid, TUD_AUDIO_FU_CTRL, TUD_AUDIO_FU_CTRLS(MIC_CHANNELS), _stridx
 
 
 
-#define TUD_AUDIO_MIC_TWO_CH_DESC_LEN (TUD_AUDIO20_DESC_IAD_LEN\
+#define TUD_AUDIO_MIC_ARRAY_DESC_LEN (TUD_AUDIO20_DESC_IAD_LEN\
   + TUD_AUDIO20_DESC_STD_AC_LEN\
   + TUD_AUDIO20_DESC_CS_AC_LEN\
   + TUD_AUDIO20_DESC_CLK_SRC_LEN\
   + TUD_AUDIO20_DESC_INPUT_TERM_LEN\
   + TUD_AUDIO20_DESC_OUTPUT_TERM_LEN\
-  + TUD_AUDIO_DESC_FEATURE_UNIT_TWO_CHANNEL_MUTEONLY_LEN\
+  + TUD_AUDIO_DESC_FEATURE_UNIT_MIC_LEN\
   + TUD_AUDIO20_DESC_STD_AS_LEN\
   + TUD_AUDIO20_DESC_STD_AS_LEN\
   + TUD_AUDIO20_DESC_CS_AS_INT_LEN\
@@ -118,21 +148,21 @@ extern "C" {
   + TUD_AUDIO20_DESC_STD_AS_ISO_EP_LEN\
   + TUD_AUDIO20_DESC_CS_AS_ISO_EP_LEN)
 
-#define TUD_AUDIO_MIC_TWO_CH_DESCRIPTOR(_itfnum, _stridx, _nBytesPerSample, _nBitsUsedPerSample, _epin, _epsize) \
+#define TUD_AUDIO_MIC_ARRAY_DESCRIPTOR(_itfnum, _stridx, _nBytesPerSample, _nBitsUsedPerSample, _epin, _epsize) \
   /* Standard Interface Association Descriptor (IAD) */\
   TUD_AUDIO20_DESC_IAD(/*_firstitf*/ _itfnum, /*_nitfs*/ 0x02, /*_stridx*/ 0x00),\
   /* Standard AC Interface Descriptor(4.7.1) */\
   TUD_AUDIO20_DESC_STD_AC(/*_itfnum*/ _itfnum, /*_nEPs*/ 0x00, /*_stridx*/ _stridx),\
   /* Class-Specific AC Interface Header Descriptor(4.7.2) */\
-  TUD_AUDIO20_DESC_CS_AC(/*_bcdADC*/ 0x0200, /*_category*/ AUDIO20_FUNC_MICROPHONE, /*_totallen*/ TUD_AUDIO20_DESC_CLK_SRC_LEN+TUD_AUDIO20_DESC_INPUT_TERM_LEN+TUD_AUDIO20_DESC_OUTPUT_TERM_LEN+TUD_AUDIO20_DESC_FEATURE_UNIT_LEN(2), /*_ctrl*/ AUDIO20_CS_AS_INTERFACE_CTRL_LATENCY_POS),\
+  TUD_AUDIO20_DESC_CS_AC(/*_bcdADC*/ 0x0200, /*_category*/ AUDIO20_FUNC_MICROPHONE, /*_totallen*/ TUD_AUDIO20_DESC_CLK_SRC_LEN+TUD_AUDIO20_DESC_INPUT_TERM_LEN+TUD_AUDIO20_DESC_OUTPUT_TERM_LEN+TUD_AUDIO_DESC_FEATURE_UNIT_MIC_LEN, /*_ctrl*/ AUDIO20_CS_AS_INTERFACE_CTRL_LATENCY_POS),\
   /* Clock Source Descriptor(4.7.2.1) */\
   TUD_AUDIO20_DESC_CLK_SRC(/*_clkid*/ 0x04, /*_attr*/ AUDIO20_CLOCK_SOURCE_ATT_INT_FIX_CLK, /*_ctrl*/ (AUDIO20_CTRL_R << AUDIO20_CLOCK_SOURCE_CTRL_CLK_FRQ_POS), /*_assocTerm*/ 0x01,  /*_stridx*/ 0x00),\
   /* Input Terminal Descriptor(4.7.2.4) */\
-  TUD_AUDIO20_DESC_INPUT_TERM(/*_termid*/ 0x01, /*_termtype*/ AUDIO_TERM_TYPE_IN_ARRAY_MIC, /*_assocTerm*/ 0x03, /*_clkid*/ 0x04, /*_nchannelslogical*/ 0x02, /*_channelcfg*/ AUDIO20_CHANNEL_CONFIG_NON_PREDEFINED, /*_idxchannelnames*/ 0x00, /*_ctrl*/ AUDIO20_CTRL_R << AUDIO20_IN_TERM_CTRL_CONNECTOR_POS, /*_stridx*/ 0x00),\
+  TUD_AUDIO20_DESC_INPUT_TERM(/*_termid*/ 0x01, /*_termtype*/ AUDIO_TERM_TYPE_IN_ARRAY_MIC, /*_assocTerm*/ 0x03, /*_clkid*/ 0x04, /*_nchannelslogical*/ MIC_CHANNELS, /*_channelcfg*/ AUDIO20_CHANNEL_CONFIG_NON_PREDEFINED, /*_idxchannelnames*/ 0x00, /*_ctrl*/ AUDIO20_CTRL_R << AUDIO20_IN_TERM_CTRL_CONNECTOR_POS, /*_stridx*/ 0x00),\
   /* Output Terminal Descriptor(4.7.2.5) */\
   TUD_AUDIO20_DESC_OUTPUT_TERM(/*_termid*/ 0x03, /*_termtype*/ AUDIO_TERM_TYPE_USB_STREAMING, /*_assocTerm*/ 0x01, /*_srcid*/ 0x02, /*_clkid*/ 0x04, /*_ctrl*/ 0x0000, /*_stridx*/ 0x00),\
   /* Feature Unit Descriptor(4.7.2.8) */\
-  TUD_AUDIO_DESC_FEATURE_UNIT_TWO_CHANNEL_MUTEONLY(/*_unitid*/ 0x02, /*_srcid*/ 0x01, /*_ctrlch0master*/ AUDIO20_CTRL_RW << AUDIO20_FEATURE_UNIT_CTRL_MUTE_POS, /*_ctrlch1*/ AUDIO20_CTRL_NONE, /*_ctrlch2*/ AUDIO20_CTRL_NONE, /*_stridx*/ 0x00),\
+  TUD_AUDIO_DESC_FEATURE_UNIT_MIC(/*_unitid*/ 0x02, /*_srcid*/ 0x01, /*_stridx*/ 0x00),\
   /* Standard AS Interface Descriptor(4.9.1) */\
   /* Interface 1, Alternate 0 - default alternate setting with 0 bandwidth */\
   TUD_AUDIO20_DESC_STD_AS_INT(/*_itfnum*/ (uint8_t)((_itfnum)+1), /*_altset*/ 0x00, /*_nEPs*/ 0x00, /*_stridx*/ 0x00),\
@@ -140,7 +170,7 @@ extern "C" {
   /* Interface 1, Alternate 1 - alternate interface for data streaming */\
   TUD_AUDIO20_DESC_STD_AS_INT(/*_itfnum*/ (uint8_t)((_itfnum)+1), /*_altset*/ 0x01, /*_nEPs*/ 0x01, /*_stridx*/ 0x00),\
   /* Class-Specific AS Interface Descriptor(4.9.2) */\
-  TUD_AUDIO20_DESC_CS_AS_INT(/*_termid*/ 0x03, /*_ctrl*/ AUDIO20_CTRL_NONE, /*_formattype*/ AUDIO20_FORMAT_TYPE_I, /*_formats*/ AUDIO20_DATA_FORMAT_TYPE_I_PCM, /*_nchannelsphysical*/ 0x02, /*_channelcfg*/ AUDIO20_CHANNEL_CONFIG_NON_PREDEFINED, /*_stridx*/ 0x00),\
+  TUD_AUDIO20_DESC_CS_AS_INT(/*_termid*/ 0x03, /*_ctrl*/ AUDIO20_CTRL_NONE, /*_formattype*/ AUDIO20_FORMAT_TYPE_I, /*_formats*/ AUDIO20_DATA_FORMAT_TYPE_I_PCM, /*_nchannelsphysical*/ MIC_CHANNELS, /*_channelcfg*/ AUDIO20_CHANNEL_CONFIG_NON_PREDEFINED, /*_stridx*/ 0x00),\
   /* Type I Format Type Descriptor(2.3.1.6 - Audio Formats) */\
   TUD_AUDIO20_DESC_TYPE_I_FORMAT(_nBytesPerSample, _nBitsUsedPerSample),\
   /* Standard AS Isochronous Audio Data Endpoint Descriptor(4.10.1.1) */\
@@ -149,16 +179,16 @@ extern "C" {
   TUD_AUDIO20_DESC_CS_AS_ISO_EP(/*_attr*/ AUDIO20_CS_AS_ISO_DATA_EP_ATT_NON_MAX_PACKETS_OK, /*_ctrl*/ AUDIO20_CTRL_NONE, /*_lockdelayunit*/ AUDIO20_CS_AS_ISO_DATA_EP_LOCK_DELAY_UNIT_UNDEFINED, /*_lockdelay*/ 0x0000)
 
 
-#define CFG_TUD_AUDIO_FUNC_1_DESC_LEN                                 TUD_AUDIO_MIC_TWO_CH_DESC_LEN
+#define CFG_TUD_AUDIO_FUNC_1_DESC_LEN                                 TUD_AUDIO_MIC_ARRAY_DESC_LEN
 #define CFG_TUD_AUDIO_FUNC_1_N_AS_INT                                 1                                       // Number of Standard AS Interface Descriptors (4.9.1) defined per audio function - this is required to be able to remember the current alternate settings of these interfaces - We restrict us here to have a constant number for all audio functions (which means this has to be the maximum number of AS interfaces an audio function has and a second audio function with less AS interfaces just wastes a few bytes)
 #define CFG_TUD_AUDIO_FUNC_1_CTRL_BUF_SZ                              64                                      // Size of control request buffer
 
 #define CFG_TUD_AUDIO_ENABLE_EP_IN                                    1
-#define CFG_TUD_AUDIO_FUNC_1_N_BYTES_PER_SAMPLE_TX                    4                                       // Driver gets this info from the descriptors - we define it here to use it to setup the descriptors and to do calculations with it below
-#define CFG_TUD_AUDIO_FUNC_1_N_CHANNELS_TX                            2                                       // Driver gets this info from the descriptors - we define it here to use it to setup the descriptors and to do calculations with it below - be aware: for different number of channels you need another descriptor!
-#define CFG_TUD_AUDIO_EP_SZ_IN                                        (48 + 1) * CFG_TUD_AUDIO_FUNC_1_N_BYTES_PER_SAMPLE_TX * CFG_TUD_AUDIO_FUNC_1_N_CHANNELS_TX      // 48 Samples (48 kHz) x 4 Bytes/Sample x 2 Channels
+#define CFG_TUD_AUDIO_FUNC_1_N_BYTES_PER_SAMPLE_TX                    MIC_BYTES_PER_SAMPLE                    // Driver gets this info from the descriptors - we define it here to use it to setup the descriptors and to do calculations with it below
+#define CFG_TUD_AUDIO_FUNC_1_N_CHANNELS_TX                            MIC_CHANNELS                            // Driver gets this info from the descriptors - we define it here to use it to setup the descriptors and to do calculations with it below - be aware: for different number of channels you need another descriptor!
+#define CFG_TUD_AUDIO_EP_SZ_IN                                        MIC_EP_SIZE_IN                          // (1 ms of frames + 1) x bytes per sample x channels
 #define CFG_TUD_AUDIO_FUNC_1_EP_IN_SZ_MAX                             CFG_TUD_AUDIO_EP_SZ_IN                  // Maximum EP IN size for all AS alternate settings used
-#define CFG_TUD_AUDIO_FUNC_1_EP_IN_SW_BUF_SZ                          4 * CFG_TUD_AUDIO_FUNC_1_EP_IN_SZ_MAX   // 4X the EP size is recommended buffer for managing usb fifo
+#define CFG_TUD_AUDIO_FUNC_1_EP_IN_SW_BUF_SZ                          ((4 * CFG_TUD_AUDIO_FUNC_1_EP_IN_SZ_MAX + MIC_BLOCK_BYTES - 1) / MIC_BLOCK_BYTES * MIC_BLOCK_BYTES)   // 4X the EP size rounded up to whole blocks, so a block written in place never wraps
 
 #ifdef __cplusplus
 }
@@ -25,6 +25,9 @@
 
 #include "tusb_config.h"
 #include "tusb.h"
+#include "spectrum.h"
+
+TU_VERIFY_STATIC(SPECTRUM_REPORT_LEN + 1 <= CFG_TUD_HID_EP_BUFSIZE, "spectrum report does not fit the HID endpoint");
 
 /* A combination of interfaces must have a unique product id, since PC will save device driver after the first plug.
  * Same VID/PID with different interface e.g MSC (first), then CDC (later) will possibly cause system error on PC.
@@ -83,7 +86,7 @@ enum                        //  construct list of defined interfaces
   ITF_NUM_TOTAL           // total of 3 interfaces, one control, one streaming, and one hid
 };
 
-#define CONFIG_TOTAL_LEN    	(TUD_CONFIG_DESC_LEN + CFG_TUD_AUDIO * TUD_AUDIO_MIC_TWO_CH_DESC_LEN) + TUD_HID_DESC_LEN
+#define CONFIG_TOTAL_LEN    	(TUD_CONFIG_DESC_LEN + CFG_TUD_AUDIO * TUD_AUDIO_MIC_ARRAY_DESC_LEN) + TUD_HID_DESC_LEN
 // the lengths of the base config descr, the audio config descr, and the hid config descr
 
 #define EPNUM_AUDIO   0x01  // EP 1 isochronus interface for audio
@@ -115,6 +118,76 @@ uint8_t const desc_hid_report[] =
     HID_REPORT_SIZE    ( 16                                     )  ,\
     HID_UNIT_EXPONENT_N( 0x097D, 2                              )  ,\
     HID_FEATURE        ( HID_DATA | HID_VARIABLE | HID_ABSOLUTE )  ,\
+  /*  the same two values pushed on the interrupt IN endpoint, followed by a status byte */\
+    HID_USAGE_N        ( 0x3404, 2                              )  ,\
+    HID_LOGICAL_MIN_N  ( 0xD8F0, 2                              )  ,\
+    HID_LOGICAL_MAX_N  ( 0x2710, 2                              )  ,\
+    HID_REPORT_COUNT   ( 1                                      )  ,\
+    HID_REPORT_SIZE    ( 16                                     )  ,\
+    HID_UNIT_EXPONENT_N( 0x097E, 2                              )  ,\
+    HID_INPUT          ( HID_DATA | HID_VARIABLE | HID_ABSOLUTE )  ,\
+    HID_USAGE_N        ( 0x7904, 2                              )  ,\
+    HID_LOGICAL_MIN_N  ( 0x0000, 2                              )  ,\
+    HID_LOGICAL_MAX_N  ( 0x7FFF, 2                              )  ,\
+    HID_UNIT_EXPONENT_N( 0x097D, 2                              )  ,\
+    HID_INPUT          ( HID_DATA | HID_VARIABLE | HID_ABSOLUTE )  ,\
+    HID_USAGE_N        ( 0x0303, 2                              )  ,\
+    HID_LOGICAL_MIN    ( 0                                      )  ,\
+    HID_LOGICAL_MAX_N  ( 0x00FF, 2                              )  ,\
+    HID_REPORT_SIZE    ( 8                                      )  ,\
+    HID_UNIT_EXPONENT  ( 0                                      )  ,\
+    HID_INPUT          ( HID_DATA | HID_VARIABLE | HID_ABSOLUTE )  ,\
+  /*  report ID 2 sets the interrupt report interval in ms, 0 = send on change only */\
+  HID_REPORT_ID      ( 2                                      )  \
+    HID_USAGE_N        ( 0x030E, 2                              )  ,\
+    HID_LOGICAL_MIN    ( 0                                      )  ,\
+    HID_LOGICAL_MAX_N  ( 0x7FFF, 2                              )  ,\
+    HID_REPORT_SIZE    ( 16                                     )  ,\
+    HID_FEATURE        ( HID_DATA | HID_VARIABLE | HID_ABSOLUTE )  ,\
+  /*  report ID 3 turns the activity gate on (1) or off (0) */\
+  HID_REPORT_ID      ( 3                                      )  \
+    HID_USAGE_PAGE_N   ( HID_USAGE_PAGE_VENDOR, 2               )  ,\
+    HID_USAGE          ( 0x01                                   )  ,\
+    HID_LOGICAL_MIN    ( 0                                      )  ,\
+    HID_LOGICAL_MAX    ( 1                                      )  ,\
+    HID_REPORT_SIZE    ( 8                                      )  ,\
+    HID_FEATURE        ( HID_DATA | HID_VARIABLE | HID_ABSOLUTE )  ,\
+  /*  report ID 4 pushes a sequence byte then the band levels, left then right, 0.5 dB steps below full scale */\
+  HID_REPORT_ID      ( 4                                      )  \
+    HID_USAGE          ( 0x02                                   )  ,\
+    HID_LOGICAL_MAX_N  ( 0x00FF, 2                              )  ,\
+    HID_INPUT          ( HID_DATA | HID_VARIABLE | HID_ABSOLUTE )  ,\
+    HID_USAGE          ( 0x03                                   )  ,\
+    HID_REPORT_COUNT   ( 2 * SPECTRUM_BANDS                     )  ,\
+    HID_INPUT          ( HID_DATA | HID_VARIABLE | HID_ABSOLUTE )  ,\
+  /*  report ID 5 sets the spectrum report interval in ms (0 = off) and reads the cpu cycles per block */\
+  HID_REPORT_ID      ( 5                                      )  \
+    HID_USAGE          ( 0x04                                   )  ,\
+    HID_LOGICAL_MAX_N  ( 0x7FFF, 2                              )  ,\
+    HID_REPORT_COUNT   ( 1                                      )  ,\
+    HID_REPORT_SIZE    ( 16                                     )  ,\
+    HID_FEATURE        ( HID_DATA | HID_VARIABLE | HID_ABSOLUTE )  ,\
+    HID_USAGE          ( 0x05                                   )  ,\
+    HID_LOGICAL_MAX_N  ( 0x7FFFFFFF, 3                          )  ,\
+    HID_REPORT_SIZE    ( 32                                     )  ,\
+    HID_FEATURE        ( HID_DATA | HID_VARIABLE | HID_ABSOLUTE )  ,\
+  /*  report ID 6 selects the audio source: 0 microphones, 1 counter pattern, 2 sweep pattern */\
+  HID_REPORT_ID      ( 6                                      )  \
+    HID_USAGE          ( 0x06                                   )  ,\
+    HID_LOGICAL_MAX    ( 2                                      )  ,\
+    HID_REPORT_SIZE    ( 8                                      )  ,\
+    HID_FEATURE        ( HID_DATA | HID_VARIABLE | HID_ABSOLUTE )  ,\
+  /*  report ID 7 pushes a trigger input edge: input number, flags, capture frame and stream frame */\
+  HID_REPORT_ID      ( 7                                      )  \
+    HID_USAGE          ( 0x07                                   )  ,\
+    HID_LOGICAL_MAX_N  ( 0x00FF, 2                              )  ,\
+    HID_REPORT_COUNT   ( 2                                      )  ,\
+    HID_REPORT_SIZE    ( 8                                      )  ,\
+    HID_INPUT          ( HID_DATA | HID_VARIABLE | HID_ABSOLUTE )  ,\
+    HID_USAGE          ( 0x08                                   )  ,\
+    HID_LOGICAL_MAX_N  ( 0x7FFFFFFF, 3                          )  ,\
+    HID_REPORT_SIZE    ( 32                                     )  ,\
+    HID_INPUT          ( HID_DATA | HID_VARIABLE | HID_ABSOLUTE )  ,\
 
   HID_COLLECTION_END \
 
@@ -130,7 +203,7 @@ uint8_t const desc_configuration[] =
 
     // interface descriptor set 
     // Interface number, string index, EP Out & EP In address, EP size
-    TUD_AUDIO_MIC_TWO_CH_DESCRIPTOR(/*_itfnum*/ ITF_NUM_AUDIO_CONTROL, /*_stridx*/ 0, /*_nBytesPerSample*/ CFG_TUD_AUDIO_FUNC_1_N_BYTES_PER_SAMPLE_TX, /*_nBitsUsedPerSample*/ CFG_TUD_AUDIO_FUNC_1_N_BYTES_PER_SAMPLE_TX*8, /*_epin*/ 0x80 | EPNUM_AUDIO, /*_epsize*/ CFG_TUD_AUDIO_EP_SZ_IN),
+    TUD_AUDIO_MIC_ARRAY_DESCRIPTOR(/*_itfnum*/ ITF_NUM_AUDIO_CONTROL, /*_stridx*/ 0, /*_nBytesPerSample*/ CFG_TUD_AUDIO_FUNC_1_N_BYTES_PER_SAMPLE_TX, /*_nBitsUsedPerSample*/ CFG_TUD_AUDIO_FUNC_1_N_BYTES_PER_SAMPLE_TX*8, /*_epin*/ 0x80 | EPNUM_AUDIO, /*_epsize*/ CFG_TUD_AUDIO_EP_SZ_IN),
 
     TUD_HID_DESCRIPTOR(ITF_NUM_HID, 0, HID_ITF_PROTOCOL_NONE, sizeof(desc_hid_report), EPNUM_HID, CFG_TUD_HID_EP_BUFSIZE, 10)
 };
@@ -23,45 +23,63 @@
  *
  */
 
+#include <string.h>
 #include "usb_mic_callbacks.h"
 
 extern uint8_t const desc_hid_report[];
 
 // Audio controls
 // Current states       values to report to host when requested
-bool mute; 						// for master channel
 uint8_t clkValid;
 uint32_t sampFreq;        // sample frequency in Hz
+volatile bool stream_active;  // host has the streaming interface at a non-zero alt setting
 
 // Range states
 audio20_control_range_4_n_t(1) sampleFreqRng; 						// Sample frequency range state
 
-const int muted_buffer[(CFG_TUD_AUDIO_EP_SZ_IN)/4] = {0};     // array of zeros to send if mute is active
-
 void usb_microphone_init() {
   tusb_init();
 
-  sampFreq = SAMPLE_RATE;    // Init values
+  sampFreq = MIC_SAMPLE_RATE;    // Init values
   clkValid = 1;
   sampleFreqRng.wNumSubRanges = 1;
-  sampleFreqRng.subrange[0].bMin = SAMPLE_RATE;
-  sampleFreqRng.subrange[0].bMax = SAMPLE_RATE;
+  sampleFreqRng.subrange[0].bMin = MIC_SAMPLE_RATE;
+  sampleFreqRng.subrange[0].bMax = MIC_SAMPLE_RATE;
   sampleFreqRng.subrange[0].bRes = 0;
 
-  mute = false;
+  mic_gain_init();                // all channels unmuted at 0 dB
+  stream_active = false;
 }
 
 
-void usb_microphone_write(const void * data, uint16_t len)
+// Blocks are built in place at the tail of the audio IN fifo rather than passed to
+// tud_audio_write(), which would copy them in a second time.  Returns the space for
+// len bytes, or NULL if the fifo cannot take them yet.  Every write is a whole block
+// and the fifo holds a whole number of blocks (tusb_config.h), so the free space
+// after the write pointer never wraps and is always word aligned.
+void * usb_microphone_write_begin(uint16_t len)
 {
-  if (mute) {
-    tud_audio_write((uint8_t *)muted_buffer, len);
-  }
-  else {
-    tud_audio_write((uint8_t *)data, len);  // note that len is a byte count.  
-  // tusb assumes data is in proper PCM format of number of bytes per sample (1,2,4) 
-  // and channel interleaving (e.g. L, R, L, R... in the case of 2 chan stereo)
-  }
+  tu_fifo_buffer_info_t info;
+  tu_fifo_get_write_info(tud_audio_get_ep_in_ff(), &info);
+  if (info.len_lin < len) return NULL;
+  return info.ptr_lin;
+}
+
+// hands len bytes written at usb_microphone_write_begin() to the audio driver.
+// tusb assumes the data is in proper PCM format of bytes per sample and channel
+// interleaving (e.g. L, R, L, R... in the case of 2 chan stereo)
+void usb_microphone_write_commit(uint16_t len)
+{
+  tu_fifo_advance_write_pointer(tud_audio_get_ep_in_ff(), len);
+}
+
+bool usb_microphone_write_silence(uint16_t len)
+{
+  void * dst = usb_microphone_write_begin(len);
+  if (dst == NULL) return false;
+  memset(dst, 0, len);
+  usb_microphone_write_commit(len);
+  return true;
 }
 
 
@@ -132,15 +150,30 @@ bool tud_audio_set_req_entity_cb(uint8_t rhport, tusb_control_request_t const *
   // If request is for our feature unit
   if ( entityID == 2 )
   {
+    TU_VERIFY(channelNum <= MIC_CHANNELS);          // 0 is the master channel
     switch ( ctrlSel )
     {
       case AUDIO20_FU_CTRL_MUTE:
         // Request uses format layout 1
         TU_VERIFY(p_request->wLength == sizeof(audio20_control_cur_1_t));
-        mute = ((audio20_control_cur_1_t*) pBuff)->bCur;
-        TU_LOG2("    Set Mute: %d of channel: %u\r\n", mute, channelNum);
+        mic_mute[channelNum] = ((audio20_control_cur_1_t*) pBuff)->bCur;
+        mic_gain_changed();
+        TU_LOG2("    Set Mute: %d of channel: %u\r\n", mic_mute[channelNum], channelNum);
       return true;
 
+      case AUDIO20_FU_CTRL_VOLUME: {
+        // Request uses format layout 2, 1/256 dB
+        TU_VERIFY(p_request->wLength == sizeof(audio20_control_cur_2_t));
+        int16_t volume = (int16_t)((audio20_control_cur_2_t*) pBuff)->bCur;
+        if (volume != MIC_VOLUME_SILENT) {                          // -infinity is kept, and silences as mute does
+            if (volume < MIC_VOLUME_MIN) volume = MIC_VOLUME_MIN;
+            if (volume > MIC_VOLUME_MAX) volume = MIC_VOLUME_MAX;
+        }
+        mic_volume[channelNum] = volume;
+        mic_gain_changed();
+        TU_LOG2("    Set Volume: %d dB/256 of channel: %u\r\n", volume, channelNum);
+      } return true;
+
         // Unknown/Unsupported control
       default:
         TU_BREAKPOINT();
@@ -204,8 +237,8 @@ bool tud_audio_get_req_entity_cb(uint8_t rhport, tusb_control_request_t const *
 
       audio20_desc_channel_cluster_t ret;
 
-      // Those are dummy values for now
-      ret.bNrChannels = 2;
+      // The channel count of the stream; no spatial locations or channel names
+      ret.bNrChannels = MIC_CHANNELS;
       ret.bmChannelConfig = 0;
       ret.iChannelNames = 0;
 
@@ -222,13 +255,35 @@ bool tud_audio_get_req_entity_cb(uint8_t rhport, tusb_control_request_t const *
   // Feature unit
   if (entityID == 2)
   {
+    TU_VERIFY(channelNum <= MIC_CHANNELS);          // 0 is the master channel
     switch (ctrlSel)
     {
       case AUDIO20_FU_CTRL_MUTE:
 	// Audio control mute cur parameter block consists of only one byte - we thus can send it right away
 	// There does not exist a range parameter block for mute
       	TU_LOG2("    Get Mute of channel: %u\r\n", channelNum);
-	      return tud_control_xfer(rhport, p_request, &mute, 1);
+	      return tud_control_xfer(rhport, p_request, &mic_mute[channelNum], 1);
+
+      case AUDIO20_FU_CTRL_VOLUME:
+        switch (p_request->bRequest)
+        {
+          case AUDIO20_CS_REQ_CUR: {
+            audio20_control_cur_2_t cur = { .bCur = mic_volume[channelNum] };
+            TU_LOG2("    Get Volume of channel: %u\r\n", channelNum);
+            return tud_audio_buffer_and_schedule_control_xfer(rhport, p_request, &cur, sizeof(cur));
+          }
+          case AUDIO20_CS_REQ_RANGE: {
+            audio20_control_range_2_n_t(1) range;
+            range.wNumSubRanges = 1;
+            range.subrange[0].bMin = MIC_VOLUME_MIN;
+            range.subrange[0].bMax = MIC_VOLUME_MAX;
+            range.subrange[0].bRes = MIC_VOLUME_RES;
+            TU_LOG2("    Get Volume range of channel: %u\r\n", channelNum);
+            return tud_audio_buffer_and_schedule_control_xfer(rhport, p_request, &range, sizeof(range));
+          }
+          // Unknown/Unsupported control
+          default: TU_BREAKPOINT(); return false;
+        }
 
 // Unknown/Unsupported control
 	  default: TU_BREAKPOINT(); return false;
@@ -283,14 +338,47 @@ bool tud_audio_tx_done_post_load_cb(uint8_t rhport, uint16_t n_bytes_copied, uin
   return true;
 }
 
+// Invoked when the host selects an alternate setting of the streaming interface
+bool tud_audio_set_itf_cb(uint8_t rhport, tusb_control_request_t const * p_request)
+{
+  (void) rhport;
+  uint8_t const alt = TU_U16_LOW(p_request->wValue);
+
+  stream_active = (alt != 0);
+  TU_LOG2("    Set interface alt %u\r\n", alt);
+  usb_microphone_stream_cb(stream_active);
+  return true;
+}
+
 bool tud_audio_set_itf_close_EP_cb(uint8_t rhport, tusb_control_request_t const * p_request)
 {
   (void) rhport;
   (void) p_request;
 
+  stream_active = false;
+  usb_microphone_stream_cb(false);
   return true;
 }
 
+//--------------------------------------------------------------------+
+// Device callbacks
+//--------------------------------------------------------------------+
+
+// Invoked when device is unmounted, the host will not be reading the stream
+void tud_umount_cb(void)
+{
+  stream_active = false;
+  usb_microphone_stream_cb(false);
+}
+
+// Invoked when usb bus is suspended, within 7ms the device must draw an average of less than 2.5 mA from the bus
+void tud_suspend_cb(bool remote_wakeup_en)
+{
+  (void) remote_wakeup_en;
+  stream_active = false;
+  usb_microphone_stream_cb(false);
+}
+
 //--------------------------------------------------------------------+
 // USB HID
 //--------------------------------------------------------------------+
@@ -308,11 +396,81 @@ uint8_t const * tud_hid_descriptor_report_cb(uint8_t itf)
 }
 
 
-int16_t read_temperature() {
-  return (int16_t)100.0*(27.0-((adc_read()*3.00/4096.0)-0.706)*581.0);          // convert adc reading to degrees C * 100
+const int16_t mic_dist_mm = 390;                                              // returns the mic spacing in mm
+
+uint16_t hid_report_interval_ms = HID_REPORT_INTERVAL_MS;                     // 0 = only send when something changes
+uint32_t hid_last_report_ms;
+int16_t hid_last_temperature;
+uint8_t hid_last_status;
+
+uint8_t hid_status() {
+  return (stream_active ? HID_STATUS_STREAMING : 0) | (mic_mute[0] ? HID_STATUS_MUTED : 0) |
+         (activity_detected ? HID_STATUS_ACTIVITY : 0);
 }
 
-const int16_t mic_dist_mm = 390;                                              // returns the mic spacing in mm
+// fills the sensor report data: temperature and distance LSB first, then status if there is room
+uint16_t hid_fill_sensor_report(uint8_t* buffer, int16_t temperature, uint16_t len) {
+  *(buffer) = (char)(temperature & 0xFF);   // write the byte portions to the buffer pointer location
+  *(buffer+1) = (char)(temperature >> 8);   //  LSB first, then MSB
+  *(buffer+2) = (char)(mic_dist_mm & 0xFF);
+  *(buffer+3) = (char)(mic_dist_mm >> 8);
+  if (len < 5) return 4;
+  *(buffer+4) = hid_status();
+  return 5;
+}
+
+// trigger report: input, flags, capture frame, then frame within the open stream, LSB first
+uint16_t hid_fill_trigger_report(uint8_t* buffer, const struct trigger_event* event) {
+  uint8_t flags = event->flags;
+  uint32_t stream_frame = event->frame - stream_first_frame;
+  // only for the stream the edge fell in, numbered as it was then
+  if (stream_active && event->stream_epoch == stream_epoch && (int32_t)stream_frame >= 0) flags |= TRIGGER_FLAG_STREAM;
+  else stream_frame = 0;
+  *(buffer) = event->input;
+  *(buffer+1) = flags;
+  for (int i = 0; i < 4; i++) *(buffer+2+i) = (uint8_t)(event->frame >> (8*i));
+  for (int i = 0; i < 4; i++) *(buffer+6+i) = (uint8_t)(stream_frame >> (8*i));
+  return TRIGGER_REPORT_LEN;
+}
+
+// Called from the main loop.  Pushes report ID 1 on the interrupt IN endpoint every
+// hid_report_interval_ms, or sooner when the temperature or status changes.  The
+// temperature comes from the background ADC average so nothing here blocks.
+// Trigger edges go first, one report per call, so a burst drains at the poll rate.
+void usb_hid_task() {
+  if (!tud_hid_ready()) return;               // not mounted, or the previous report is still queued
+
+  struct trigger_event event;
+  if (trigger_input_peek(&event)) {
+    uint8_t report[TRIGGER_REPORT_LEN];
+    hid_fill_trigger_report(report, &event);
+    if (tud_hid_report(HID_REPORT_ID_TRIGGER, report, sizeof(report))) trigger_input_pop();
+    return;
+  }
+
+  uint32_t now = to_ms_since_boot(get_absolute_time());
+  int16_t temperature = temp_sensor_read();
+  uint8_t status = hid_status();
+
+  bool changed = (status != hid_last_status) ||
+                 (abs(temperature - hid_last_temperature) >= HID_REPORT_TEMP_CHANGE);
+  bool due = (hid_report_interval_ms != 0) && (now - hid_last_report_ms >= hid_report_interval_ms);
+  if (changed || due) {
+    uint8_t report[5];
+    uint16_t len = hid_fill_sensor_report(report, temperature, sizeof(report));
+    if (tud_hid_report(HID_REPORT_ID_SENSOR, report, len)) {
+      hid_last_report_ms = now;
+      hid_last_temperature = temperature;
+      hid_last_status = status;
+    }
+    return;                                   // one report per call, the spectrum goes next time
+  }
+
+  uint8_t spectrum[SPECTRUM_REPORT_LEN];
+  if (spectrum_take_report(spectrum)) {
+    tud_hid_report(HID_REPORT_ID_SPECTRUM, spectrum, sizeof(spectrum));
+  }
+}
 
 
 // Invoked when received GET_REPORT control request
@@ -320,20 +478,34 @@ const int16_t mic_dist_mm = 390;                                              //
 // Return zero will cause the stack to STALL request
 uint16_t tud_hid_get_report_cb(uint8_t itf, uint8_t report_id, hid_report_type_t report_type, uint8_t* buffer, uint16_t reqlen)
 {
-  int16_t response;
-
-  if (report_id == 1) {                   //  report ID 1 is the only supported report
-    response =  read_temperature();
-    *(buffer) = (char)(response & 0xFF);    // write the byte portions to the buffer pointer location
-    *(buffer+1) = (char)(response >> 8);    //  LSB first, then MSB
-    *(buffer+2) = (char)(mic_dist_mm & 0xFF);
-    *(buffer+3) = (char)(mic_dist_mm >> 8);
-  }
-
   (void) itf;
-  (void) report_type;
-  (void) reqlen;
-  return 4;                                 // 4 bytes of data copied to buffer
+
+  if (report_id == HID_REPORT_ID_SENSOR) {
+    // the feature report keeps its original 4 byte layout, the input report adds the status byte
+    uint16_t len = (report_type == HID_REPORT_TYPE_INPUT) ? reqlen : 4;
+    return hid_fill_sensor_report(buffer, temp_sensor_read(), len);
+  }
+  if (report_id == HID_REPORT_ID_INTERVAL && reqlen >= 2) {
+    *(buffer) = (char)(hid_report_interval_ms & 0xFF);
+    *(buffer+1) = (char)(hid_report_interval_ms >> 8);
+    return 2;
+  }
+  if (report_id == HID_REPORT_ID_GATE && reqlen >= 1) {
+    *(buffer) = activity_gate_enabled;
+    return 1;
+  }
+  if (report_id == HID_REPORT_ID_SPECTRUM_CFG && reqlen >= 6) {
+    uint32_t cycles = spectrum_cycles_per_block;
+    *(buffer) = (char)(spectrum_interval_ms & 0xFF);
+    *(buffer+1) = (char)(spectrum_interval_ms >> 8);
+    for (int i = 0; i < 4; i++) *(buffer+2+i) = (char)(cycles >> (8*i));
+    return 6;
+  }
+  if (report_id == HID_REPORT_ID_TEST_SIGNAL && reqlen >= 1) {
+    *(buffer) = test_signal_mode;
+    return 1;
+  }
+  return 0;
 }
 
 
@@ -341,12 +513,25 @@ uint16_t tud_hid_get_report_cb(uint8_t itf, uint8_t report_id, hid_report_type_t
 // received data on OUT endpoint ( Report ID = 0, Type = 0 )
 void tud_hid_set_report_cb(uint8_t itf, uint8_t report_id, hid_report_type_t report_type, uint8_t const* buffer, uint16_t bufsize)
 {
-  
   (void) itf;
-  (void) report_id;
   (void) report_type;
-  (void) buffer;
 
+  if (report_id == HID_REPORT_ID_INTERVAL && bufsize >= 2) {
+    hid_report_interval_ms = buffer[0] | (buffer[1] << 8);
+    TU_LOG2("    Set HID report interval: %u ms\r\n", hid_report_interval_ms);
+  }
+  if (report_id == HID_REPORT_ID_GATE && bufsize >= 1) {
+    activity_gate_enabled = (buffer[0] != 0);
+  }
+  if (report_id == HID_REPORT_ID_SPECTRUM_CFG && bufsize >= 2) {
+    spectrum_interval_ms = buffer[0] | (buffer[1] << 8);   // the cycle count is read only
+  }
+  // a pattern the sample format would cut is refused, it could only be counted as corrupt
+  if (report_id == HID_REPORT_ID_TEST_SIGNAL && bufsize >= 1 && buffer[0] <= TEST_PATTERN_SWEEP &&
+      TEST_PATTERN_FITS(buffer[0], MIC_WIRE_BITS)) {
+    test_signal_mode = buffer[0];
+    TU_LOG2("    Set test signal: %u\r\n", test_signal_mode);
+  }
 }
 
 
@@ -28,19 +28,47 @@
 
 #include "tusb_config.h"
 #include "tusb.h"
+#include "mic_config.h"
 
-#ifndef SAMPLE_RATE
-#define SAMPLE_RATE ((CFG_TUD_AUDIO_EP_SZ_IN / 8) - 1) * 1000
+#ifndef HID_REPORT_INTERVAL_MS
+#define HID_REPORT_INTERVAL_MS 1000       // default period of the interrupt IN sensor report
 #endif
 
-#ifndef SAMPLE_BUFFER_SIZE
-#define SAMPLE_BUFFER_SIZE ((CFG_TUD_AUDIO_EP_SZ_IN/2) - 1)
+#ifndef HID_REPORT_TEMP_CHANGE
+#define HID_REPORT_TEMP_CHANGE 10         // temperature change (deg C * 100) that sends a report early
 #endif
 
+#define HID_REPORT_ID_SENSOR    1         // temperature, mic distance, status
+#define HID_REPORT_ID_INTERVAL  2         // feature report, interrupt report interval in ms
+#define HID_REPORT_ID_GATE      3         // feature report, 1 = silence the stream between activity
+#define HID_REPORT_ID_SPECTRUM  4         // input report, band levels of both channels
+#define HID_REPORT_ID_SPECTRUM_CFG 5      // feature report, spectrum interval in ms and cpu cycles per block
+#define HID_REPORT_ID_TEST_SIGNAL 6       // feature report, 0 = microphones, 1 = counter, 2 = sweep (test_pattern.h)
+#define HID_REPORT_ID_TRIGGER   7         // input report, trigger input edge and its frame numbers
 
-#include "hardware/adc.h"
+#define HID_STATUS_STREAMING    0x01      // status byte bits of the sensor input report
+#define HID_STATUS_MUTED        0x02
+#define HID_STATUS_ACTIVITY     0x04      // activity detector is triggered
+
+#include <stdlib.h>
+#include "pico/stdlib.h"
+#include "temp_sensor.h"
+#include "activity_detector.h"
+#include "spectrum.h"
+#include "test_pattern.h"
+#include "mic_gain.h"
+#include "trigger_input.h"
 
 void usb_microphone_init();
-void usb_microphone_write(const void * data, uint16_t len);
+void * usb_microphone_write_begin(uint16_t len);    // NULL while the USB fifo is full
+void usb_microphone_write_commit(uint16_t len);
+bool usb_microphone_write_silence(uint16_t len);
+
+// Implemented by the application.  Called from tud_task() when the host opens the
+// streaming interface (alt setting != 0) or stops reading it (alt 0, unmount, suspend).
+void usb_microphone_stream_cb(bool open);
+extern volatile uint8_t test_signal_mode;   // synthetic source in place of the microphones, TEST_PATTERN_*
+extern uint32_t stream_first_frame;         // capture frame number of the first frame the host received
+void usb_hid_task();
 
 #endif